@@ -2,7 +2,7 @@
 
 #include <cstdint>
 
-#include <WinSock2.h>
+#include <Network/Native.h>
 
 namespace network {
 
@@ -15,7 +15,7 @@ namespace network {
 		}
 
 	private:
-		IN_ADDR _addr;
+		in_addr _addr;
 	};
 
 }
\ No newline at end of file
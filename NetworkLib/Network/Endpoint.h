@@ -1,7 +1,8 @@
 #pragma once
 
-#include <WinSock2.h>
-#include <WS2tcpip.h>
+#include <cstring>
+
+#include <Network/Native.h>
 
 #include <Network/Address/Address.h>
 
@@ -12,9 +13,9 @@ namespace network {
 	public:
 		Endpoint(int family, std::uint16_t port) noexcept {
 			if (family == AF_INET) {
-				_data.base.v4.sin_family = AF_INET;
-				_data.base.v4.sin_port = port;
-				_data.base.v4.sin_addr = INADDR_ANY;
+				_data.v4.sin_family = AF_INET;
+				_data.v4.sin_port = port;
+				_data.v4.sin_addr.s_addr = INADDR_ANY;
 			}
 			else {
 				// TODO: ipv6
@@ -29,9 +30,9 @@ namespace network {
 
 		Endpoint(const Address &addr, std::uint16_t port) noexcept {
 			if (addr.IsV4()) {
-				_data.base.v4.sin_family = AF_INET;
-				_data.base.v4.sin_port = port;
-				_data.base.v4.sin_addr = addr.V4().to_uint32();
+				_data.v4.sin_family = AF_INET;
+				_data.v4.sin_port = port;
+				_data.v4.sin_addr.s_addr = addr.V4().to_uint32();
 			}
 			else {
 				// TODO: ipv6
@@ -1,15 +1,15 @@
 #pragma once
 
-#include <WinSock2.h>
+#include <Network/Native.h>
 
 #include <Util/Error.h>
 
 namespace network {
 
-	static void GetSocketError(util::error::Error &err, int ec) {
-		if (ec == SOCKET_ERROR) {
-			ec = WSAGetLastError();
-			if (ec != WSAEWOULDBLOCK) {
+	static void GetSocketError(util::error::Error &err, std::int64_t ret) {
+		if (ret == native::ERROR_RESULT) {
+			int ec = native::LastError();
+			if (!native::WouldBlock(ec)) {
 				err = util::error::lib::SocketError(ec);
 				return;
 			}
@@ -23,6 +23,8 @@ namespace network {
 		enum class NetworkErrorCode {
 			NONE = 0,
 			CLOSED,
+			// no resolved endpoint matches the socket's protocol
+			NO_ENDPOINT,
 		};
 
 		REGISTER_ERROR(Network);
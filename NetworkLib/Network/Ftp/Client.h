@@ -1,6 +1,11 @@
 #pragma once
 
+#include <atomic>
 #include <string>
+#include <thread>
+#include <vector>
+#include <charconv>
+#include <functional>
 #include <fstream>
 #include <sstream>
 
@@ -14,11 +19,23 @@
 #include <Network/Ftp/Parser/HostPortParser.h>
 #include <Network/Ftp/Parser/FileListParser.h>
 
-#include <network/Parser/DQuotedParser.h>
+#include <Network/Parser/DQuotedParser.h>
 
 #include <Util/IO.h>
 #include <Util/Error.h>
+#include <Util/Uring.h>
 #include <Util/Buffer.h>
+#include <Util/RingBuffer.h>
+#include <Util/BufferPool.h>
+#include <Util/IOBuf.h>
+#include <Util/Journal.h>
+
+#ifndef _WIN32
+#include <map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
 
 namespace network {
 
@@ -26,7 +43,19 @@ namespace network {
 
 		class Client : public Tcp::Socket {
 		public:
-			using DynamicStringBuffer = util::buffer::DynamicStringBuffer<char, std::char_traits<char>, std::allocator<char>>;
+			// receives downloaded data as it arrives and may keep it; returning false aborts the transfer
+			using DataSink = std::function<bool(util::buffer::IOBuf &&)>;
+
+			// the final reply to one command of a batch, msg is the text of its first line without the line end
+			struct CmdResult {
+				CmdType type;
+				uint16_t code;
+				std::string msg;
+
+				bool Positive() const noexcept {
+					return (code >= 100) && (code < 400);
+				}
+			};
 
 		public:
 			Client(util::io::IOContext &ctx, 
@@ -39,11 +68,79 @@ namespace network {
 				_server_endpoints(server_endpoints),
 				_user(user),
 				_pass(pass),
-				_buffer(_buff, buffer_size),
-				_buffer_size(buffer_size) {}
+				_buffer(buffer_size),
+				_buffer_size(buffer_size),
+				_pool(&util::buffer::BufferPool::Default()),
+				_engine(TransferEngine::STREAM),
+				_segments(1),
+				_received(0),
+#ifndef _WIN32
+				_journal(nullptr),
+				_checkpoint(16 * 1024 * 1024),
+#endif
+				_control_profile(option::Profile::LowLatency()),
+				_data_profile(option::Profile::BulkThroughput()),
+				_timeout(std::chrono::milliseconds::zero()) {}
+
+			TransferEngine Engine() const noexcept {
+				return _engine;
+			}
+
+			void SetEngine(TransferEngine engine) noexcept {
+				_engine = engine;
+			}
+
+			// Download(dst_path, src_path) splits files into up to n ranges fetched at once, each over
+			// its own logged-in session; files under SEGMENT_MIN_SIZE per range are not split
+			void SetSegments(size_t n) noexcept {
+				_segments = (std::max)(n, (size_t)1);
+			}
+
+			size_t Segments() const noexcept {
+				return _segments;
+			}
+
+#ifndef _WIN32
+			// With a journal, Download(dst_path, src_path) and Upload(dst_path, src_path) resume where
+			// an earlier attempt at the same transfer stopped. Downloads record their offset every
+			// checkpoint bytes, after the data itself is on disk; uploads resume from the size the
+			// server reports. journal has to outlive the client, downloads are then not segmented.
+			void SetJournal(util::io::Journal *journal, uint64_t checkpoint = 16 * 1024 * 1024) noexcept {
+				_journal = journal;
+				_checkpoint = (std::max)(checkpoint, (uint64_t)1);
+			}
+#endif
+
+			// transfer buffers are drawn from pool, which has to outlive the client
+			void SetBufferPool(util::buffer::BufferPool &pool) noexcept {
+				_pool = &pool;
+			}
+
+			void SetControlProfile(const option::Profile &p) noexcept {
+				_control_profile = p;
+			}
+
+			void SetDataProfile(const option::Profile &p) noexcept {
+				_data_profile = p;
+			}
+
+			// bounds connecting, every command/reply exchange and every wait for the data connection;
+			// zero waits forever
+			void SetTimeout(std::chrono::milliseconds timeout) noexcept {
+				_timeout = timeout;
+			}
+
+			std::chrono::milliseconds Timeout() const noexcept {
+				return _timeout;
+			}
 
 			void Init(util::error::Error &err) {
-				Connect(_server_endpoints, err);
+				Apply(_control_profile, err);
+				if (err) {
+					return;
+				}
+
+				Connect(_server_endpoints, _timeout, err);
 				if (err) {
 					return;
 				}
@@ -67,7 +164,7 @@ namespace network {
 				}
 
 				network::parser::DQuotedParser parser(dir);
-				parser.Input(rs.front()->Msg());
+				parser.Input(rs.front().Msg());
 				parser.Eoi();
 				if (!parser.Succeeded()) {
 					err = error::FtpError(error::FtpErrorCode::REPLY_BAD_MSG, "pwd");
@@ -75,6 +172,37 @@ namespace network {
 				}
 			}
 
+			// in binary: SIZE counts the bytes of the current TYPE and servers may refuse it in ASCII,
+			// so TYPE I goes out in front of it
+			void Size(const std::string &path, uint64_t &size, util::error::Error &err) {
+				std::vector<Cmd> cmds;
+				cmds.emplace_back(CmdType::TYPE, (char)DataType::IMAGE);
+				cmds.emplace_back(CmdType::SIZE, path);
+
+				std::vector<CmdResult> results;
+				Batch(cmds, results, err);
+				if (err) {
+					return;
+				}
+
+				CheckResults(results, err);
+				if (err) {
+					return;
+				}
+
+				const std::string &msg = results[1].msg;
+				auto r = std::from_chars(msg.data(), msg.data() + msg.size(), size);
+				if (r.ec != std::errc()) {
+					err = error::FtpError(error::FtpErrorCode::REPLY_BAD_MSG, "size");
+					return;
+				}
+			}
+
+			// keeps the control connection alive, or finds out that it is not
+			void Noop(util::error::Error &err) {
+				SendCmd(CmdType::NOOP, err);
+			}
+
 			void Cwd(const std::string &dir, util::error::Error &err) {
 				Reply::Sequence rs;
 				if (!SendCmd(rs, CmdType::CWD, err, dir)) {
@@ -85,35 +213,52 @@ namespace network {
 				}
 			}
 
-			void List(File::List &list, util::error::Error &err) {
-				Tcp::Socket conn(_ctx, _protocol);
-				OpenDataConnection(conn, err);
-				if (err) {
-					return;
-				}
-				
-				auto read_future = _ctx.Commit(&Client::ReadFileList, this, &list, &conn);
+			// Sends cmds back to back and matches the replies to them in order, so the whole batch
+			// costs about one round trip instead of one per command. A negative reply only fails its
+			// own command; err is set for failures of the connection. The commands must not open a
+			// data connection (DELE, MKD, RMD, SIZE, MDTM, SITE, NOOP, ...).
+			void Batch(const std::vector<Cmd> &cmds, std::vector<CmdResult> &results, util::error::Error &err) {
+				results.clear();
+				results.reserve(cmds.size());
 
+				util::buffer::ConstBufferSequence bs;
 				Reply::Sequence rs;
-				SendCmd(rs, CmdType::LIST, err);
-				if (err) {
-					return;
-				}
+				size_t sent = 0;
+				while (results.size() < cmds.size()) {
+					util::io::Deadline deadline = util::io::After(_timeout);
 
-				read_future.wait();
-				err = read_future.get();
-				if (err) {
-					return;
-				}
+					bs.clear();
+					for (; (sent < cmds.size()) && ((sent - results.size()) < PIPELINE_WINDOW); sent++) {
+						bs.push_back(cmds[sent].Buffer());
+					}
+					if (!bs.empty()) {
+						util::io::Write(*this, bs, deadline, err);
+						if (err) {
+							return;
+						}
+					}
 
-				if (!WaitForReply(err)) {
-					return;
+					ReadFinalReply(rs, deadline, err);
+					if (err) {
+						return;
+					}
+
+					results.push_back(Result(cmds[results.size()], rs));
 				}
 			}
 
+			void List(File::List &list, util::error::Error &err) {
+				ListCmd(list, err);
+			}
+
+			// the entries of dir instead of the working directory
+			void List(const std::string &dir, File::List &list, util::error::Error &err) {
+				ListCmd(list, err, dir);
+			}
+
 			void Download(std::basic_ostream<char, std::char_traits<char>> &os, const std::string &src_path, util::error::Error &err) {
 				Tcp::Socket conn(_ctx, _protocol);
-				OpenDataConnection(conn, err);
+				OpenDataConnection(conn, DataType::IMAGE, 0, err);
 				if (err) {
 					return;
 				}
@@ -123,6 +268,7 @@ namespace network {
 				Reply::Sequence rs;
 				SendCmd(rs, CmdType::RETR, err, src_path);
 				if (err) {
+					Cancel(conn, read_future);
 					return;
 				}
 
@@ -137,7 +283,56 @@ namespace network {
 				}
 			}
 
+			void Download(const DataSink &sink, const std::string &src_path, util::error::Error &err) {
+				Transfer(&Client::ReadAllTo, &sink, CmdType::RETR, src_path, err);
+			}
+
 			void Download(const std::string &dst_path, const std::string &src_path, util::error::Error &err) {
+#ifndef _WIN32
+				if (_journal || (_segments > 1)) {
+					uint64_t size = 0;
+					Size(src_path, size, err);
+					if (!err && _journal) {
+						ResumableDownload(dst_path, src_path, size, err);
+						return;
+					}
+					if (!err && (size >= 2 * SEGMENT_MIN_SIZE)) {
+						SegmentedDownload(dst_path, src_path, size, err);
+						return;
+					}
+					// no SIZE or too small to split, one stream then
+					err = util::error::Error::None();
+				}
+#endif
+
+#ifdef UTIL_IO_URING
+				if ((_engine == TransferEngine::URING) && OpenUring()) {
+					int fd = ::open(dst_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+					if (fd < 0) {
+						err = util::error::IOError(util::error::IOErrorCode::OPEN_FILE_FAILED, "download");
+						return;
+					}
+
+					Transfer(&Client::ReadAllUring, fd, CmdType::RETR, src_path, err);
+					::close(fd);
+					return;
+				}
+#endif
+
+#if defined(__linux__)
+				if (_engine == TransferEngine::SPLICE) {
+					int fd = ::open(dst_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+					if (fd < 0) {
+						err = util::error::IOError(util::error::IOErrorCode::OPEN_FILE_FAILED, "download");
+						return;
+					}
+
+					Transfer(&Client::SpliceAll, fd, CmdType::RETR, src_path, err);
+					::close(fd);
+					return;
+				}
+#endif
+
 				std::ofstream os(dst_path, std::ios::binary);
 				if (!os.is_open()) {
 					err = util::error::IOError(util::error::IOErrorCode::OPEN_FILE_FAILED, "download");
@@ -148,9 +343,17 @@ namespace network {
 				os.close();
 			}
 
+			// size is the number of bytes moved over the data connections, less than the file size
+			// when a download resumed
+			void Download(const std::string &dst_path, const std::string &src_path, uint64_t &size, util::error::Error &err) {
+				_received = 0;
+				Download(dst_path, src_path, err);
+				size = _received;
+			}
+
 			void Upload(std::basic_istream<char, std::char_traits<char>> &is, const std::string &dst_path, util::error::Error &err) {
 				Tcp::Socket conn(_ctx, _protocol);
-				OpenDataConnection(conn, err);
+				OpenDataConnection(conn, DataType::IMAGE, 0, err);
 				if (err) {
 					return;
 				}
@@ -160,6 +363,7 @@ namespace network {
 				Reply::Sequence rs;
 				SendCmd(rs, CmdType::STOR, err, dst_path);
 				if (err) {
+					Cancel(conn, read_future);
 					return;
 				}
 
@@ -179,7 +383,56 @@ namespace network {
 				}
 			}
 
+			// data stays referenced until the kernel has released every page sent from it
+			void Upload(const std::shared_ptr<const std::string> &data, const std::string &dst_path, util::error::Error &err) {
+				if (!data) {
+					err = util::error::RuntimeError(util::error::RuntimeErrorCode::NULL_POINTER, "upload");
+					return;
+				}
+
+				Transfer(&Client::WriteAllZeroCopy, data, CmdType::STOR, dst_path, err);
+			}
+
 			void Upload(const std::string &dst_path, const std::string &src_path, util::error::Error &err) {
+#ifndef _WIN32
+				if (_journal) {
+					ResumableUpload(dst_path, src_path, err);
+					return;
+				}
+#endif
+
+#ifdef UTIL_IO_URING
+				if ((_engine == TransferEngine::URING) && OpenUring()) {
+					int fd = ::open(src_path.c_str(), O_RDONLY | O_CLOEXEC);
+					if (fd < 0) {
+						err = util::error::IOError(util::error::IOErrorCode::OPEN_FILE_FAILED, "upload");
+						return;
+					}
+
+					Transfer(&Client::WriteAllUring, fd, CmdType::STOR, dst_path, err);
+					::close(fd);
+					return;
+				}
+#endif
+
+#if defined(__linux__)
+				if (_engine == TransferEngine::STREAM) {
+					int fd = ::open(src_path.c_str(), O_RDONLY | O_CLOEXEC);
+					if (fd < 0) {
+						err = util::error::IOError(util::error::IOErrorCode::OPEN_FILE_FAILED, "upload");
+						return;
+					}
+
+					struct stat st;
+					if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode)) {
+						Transfer(&Client::SendFileAll, fd, CmdType::STOR, dst_path, err);
+						::close(fd);
+						return;
+					}
+					::close(fd);
+				}
+#endif
+
 				std::ifstream is(src_path, std::ios::binary);
 				if (!is.is_open()) {
 					err = util::error::IOError(util::error::IOErrorCode::OPEN_FILE_FAILED, "upload");
@@ -190,25 +443,207 @@ namespace network {
 				is.close();
 			}
 
+#ifdef UTIL_COROUTINE
+			// Awaitable counterparts of the calls above. They run on the reactor of the context,
+			// e.g. util::io::Spawn(ctx.GetReactor(), ...), so that one thread serves many clients.
+			// A client is driven either through these or through the blocking calls, not both.
+			util::io::Task<> AsyncInit(util::error::Error &err) {
+				Apply(_control_profile, err);
+				if (err) {
+					co_return;
+				}
+
+				co_await AsyncConnectAny(*this, _server_endpoints, err);
+				if (err) {
+					co_return;
+				}
+
+				Reply::Sequence rs;
+				co_await AsyncWaitForReply(rs, err);
+				if (err) {
+					co_return;
+				}
+
+				std::vector<Cmd> cmds = LoginCmds();
+				std::vector<CmdResult> results;
+				co_await AsyncBatch(cmds, results, err);
+				if (err) {
+					co_return;
+				}
+
+				CheckLogin(results, err);
+			}
+
+			util::io::Task<> AsyncBatch(const std::vector<Cmd> &cmds, std::vector<CmdResult> &results, util::error::Error &err) {
+				results.clear();
+				results.reserve(cmds.size());
+
+				Reply::Sequence rs;
+				size_t sent = 0;
+				while (results.size() < cmds.size()) {
+					util::io::Deadline deadline = util::io::After(_timeout);
+
+					for (; (sent < cmds.size()) && ((sent - results.size()) < PIPELINE_WINDOW); sent++) {
+						co_await util::io::AsyncWrite(*this, cmds[sent].Buffer(), deadline, err);
+						if (err) {
+							co_return;
+						}
+					}
+
+					co_await AsyncReadFinalReply(rs, deadline, err);
+					if (err) {
+						co_return;
+					}
+
+					results.push_back(Result(cmds[results.size()], rs));
+				}
+			}
+
+			util::io::Task<> AsyncPwd(std::string &dir, util::error::Error &err) {
+				Reply::Sequence rs;
+				co_await AsyncSendCmd(rs, Cmd(CmdType::PWD), err);
+				if (err) {
+					co_return;
+				}
+
+				network::parser::DQuotedParser parser(dir);
+				parser.Input(rs.front().Msg());
+				parser.Eoi();
+				if (!parser.Succeeded()) {
+					err = error::FtpError(error::FtpErrorCode::REPLY_BAD_MSG, "pwd");
+					co_return;
+				}
+			}
+
+			util::io::Task<> AsyncCwd(const std::string &dir, util::error::Error &err) {
+				bool ok = co_await AsyncSendCmd(Cmd(CmdType::CWD, dir), err);
+				if (!ok && !err) {
+					err = error::FtpError(error::FtpErrorCode::CWD_FAILED, "cwd");
+				}
+			}
+
+			util::io::Task<> AsyncList(File::List &list, util::error::Error &err) {
+				network::ftp::parser::FileListParser parser(list);
+				co_await AsyncTransfer(Cmd(CmdType::LIST), DataType::ASCII, [this, &parser](Tcp::Socket &conn, util::error::Error &err) -> util::io::Task<> {
+					co_await AsyncReadData(conn, [&parser](const util::buffer::ConstBuffer &b) {
+						parser.Input(b);
+						return !parser.Failed();
+					}, err);
+					if (err) {
+						co_return;
+					}
+
+					parser.Eoi();
+					if (!parser.Succeeded()) {
+						err = error::FtpError(error::FtpErrorCode::READ_FILE_LIST_FAILED);
+					}
+				}, err);
+			}
+
+			util::io::Task<> AsyncDownload(std::basic_ostream<char, std::char_traits<char>> &os, const std::string &src_path, util::error::Error &err) {
+				co_await AsyncTransfer(Cmd(CmdType::RETR, src_path), DataType::IMAGE, [this, &os](Tcp::Socket &conn, util::error::Error &err) {
+					return AsyncReadData(conn, [&os](const util::buffer::ConstBuffer &b) {
+						os.write(static_cast<const char *>(b.Data()), b.Size());
+						return !os.fail();
+					}, err);
+				}, err);
+			}
+
+			util::io::Task<> AsyncDownload(const std::string &dst_path, const std::string &src_path, util::error::Error &err) {
+				std::ofstream os(dst_path, std::ios::binary);
+				if (!os.is_open()) {
+					err = util::error::IOError(util::error::IOErrorCode::OPEN_FILE_FAILED, "download");
+					co_return;
+				}
+
+				co_await AsyncDownload(dynamic_cast<std::basic_ostream<char, std::char_traits<char>> &>(os), src_path, err);
+				os.close();
+			}
+
+			util::io::Task<> AsyncUpload(std::basic_istream<char, std::char_traits<char>> &is, const std::string &dst_path, util::error::Error &err) {
+				co_await AsyncTransfer(Cmd(CmdType::STOR, dst_path), DataType::IMAGE, [this, &is](Tcp::Socket &conn, util::error::Error &err) -> util::io::Task<> {
+					auto buff = _pool->Acquire(_buffer_size);
+					if (!buff) {
+						err = util::error::RuntimeError(util::error::RuntimeErrorCode::MEMORY_LIMIT_EXCEEDED);
+						co_return;
+					}
+
+					while (is.read(buff.Data(), _buffer_size) || (is.gcount() > 0)) {
+						auto b = buff.Buffer((size_t)is.gcount());
+						co_await util::io::AsyncWrite(conn, b, util::io::After(_timeout), err);
+						if (err) {
+							co_return;
+						}
+					}
+				}, err);
+			}
+
+			util::io::Task<> AsyncUpload(const std::string &dst_path, const std::string &src_path, util::error::Error &err) {
+				std::ifstream is(src_path, std::ios::binary);
+				if (!is.is_open()) {
+					err = util::error::IOError(util::error::IOErrorCode::OPEN_FILE_FAILED, "upload");
+					co_return;
+				}
+
+				co_await AsyncUpload(dynamic_cast<std::basic_istream<char, std::char_traits<char>> &>(is), dst_path, err);
+				is.close();
+			}
+#endif
+
 		private:
 			Tcp::Resolver::Result::Ptr _server_endpoints;
 
 			std::string _user;
 			std::string _pass;
 			
-			std::string _buff;
-			DynamicStringBuffer _buffer;
+			util::buffer::RingBuffer _buffer;
 
 			size_t _buffer_size;
+			util::buffer::BufferPool *_pool;
+
+			TransferEngine _engine;
+			size_t _segments;
+			// data bytes read by the download engines, summed over the segments of a download
+			std::atomic<uint64_t> _received;
+
+#ifndef _WIN32
+			util::io::Journal *_journal;
+			uint64_t _checkpoint;
+#endif
+
+			option::Profile _control_profile;
+			option::Profile _data_profile;
+
+			std::chrono::milliseconds _timeout;
+
+			// below this the pinning and completion cost of MSG_ZEROCOPY exceeds the copy it saves
+			static const size_t ZEROCOPY_MIN_SIZE = 16384;
+			static const uint64_t SEGMENT_MIN_SIZE = 1024 * 1024;
+
+			// commands of a batch written ahead of their replies, bounded so that unread replies
+			// cannot fill the socket buffers while the next commands are written
+			static const size_t PIPELINE_WINDOW = 16;
+
+#ifdef UTIL_IO_URING
+			static const size_t URING_BUFFERS = 4;
+			static const uint64_t URING_WRITE = 1ull << 63;
+			// the link timeout that bounds the socket request
+			static const uint64_t URING_TIMEOUT = 1ull << 62;
+
+			util::buffer::BufferPool::Block _uring_buff;
+			std::vector<util::buffer::MutableBuffer> _uring_buffers;
+			std::unique_ptr<util::io::Uring> _uring;
+#endif
 
 		private:
 			bool SendCmd(Reply::Sequence &rs, const Cmd &c, util::error::Error &err) {
-				util::io::Write(*this, util::buffer::ConstBuffer::From(c.Str()), err);
+				util::io::Deadline deadline = util::io::After(_timeout);
+				util::io::Write(*this, c.Buffer(), deadline, err);
 				if (err) {
 					return false;
 				}
 
-				WaitForReply(rs, err);
+				WaitForReply(rs, deadline, err);
 				if (err) {
 					return false;
 				}
@@ -234,33 +669,59 @@ namespace network {
 				return SendCmd(rs, c, err);
 			}
 
-			void WaitForReply(Reply::Sequence &rs, util::error::Error &err) {
-				using namespace std::string_literals;
+			void WaitForReply(Reply::Sequence &rs, const util::io::Deadline &deadline, util::error::Error &err) {
+				ReadReply(rs, deadline, err);
+				if (err) {
+					return;
+				}
+
+				if (!rs.Positive()) {
+					err = error::FtpError((rs.Type() == Reply::ReplyType::TRANSIENT_NEGATIVE_COMPLETION)
+						? error::FtpErrorCode::REPLY_TRANSIENT_NEGATIVE
+						: error::FtpErrorCode::REPLY_NEGATIVE);
+					return;
+				}
+			}
 
+			void ReadReply(Reply::Sequence &rs, const util::io::Deadline &deadline, util::error::Error &err) {
 				size_t nread;
-				std::string raw_reply;
 				while (!rs.End()) {
-					nread = util::io::ReadUntil(*this, _buffer, err, "\r\n"s, "\n"s);
+					nread = util::io::ReadUntil(*this, _buffer, deadline, err, FTP_LINE_END);
 					if (err) {
 						return;
 					}
 
-					_buffer.Consume(raw_reply, nread);
-					rs.Parse(raw_reply, err);
+					// parsed in place, the line is gone after Consume
+					rs.Parse(_buffer.View(nread), err);
+					_buffer.Consume(nread);
 					if (err) {
 						return;
 					}
 				}
+			}
 
-				if (!rs.Positive()) {
-					err = error::FtpError(error::FtpErrorCode::REPLY_NEGATIVE);
-					return;
+			// skips preliminary 1xx replies
+			void ReadFinalReply(Reply::Sequence &rs, const util::io::Deadline &deadline, util::error::Error &err) {
+				do {
+					rs.Clear();
+					ReadReply(rs, deadline, err);
+					if (err) {
+						return;
+					}
+				} while (rs.Type() == Reply::ReplyType::PRELIMINARY);
+			}
+
+			static CmdResult Result(const Cmd &c, const Reply::Sequence &rs) {
+				std::string_view msg = rs.front().Msg();
+				while (!msg.empty() && ((msg.back() == '\n') || (msg.back() == '\r'))) {
+					msg.remove_suffix(1);
 				}
+				return { c.Type(), rs.Code(), std::string(msg) };
 			}
 
 			bool WaitForReply(util::error::Error &err) {
 				Reply::Sequence rs;
-				WaitForReply(rs, err);
+				WaitForReply(rs, util::io::After(_timeout), err);
 				if (err) {
 					return false;
 				}
@@ -270,36 +731,70 @@ namespace network {
 
 			void Welcome(util::error::Error &err) {
 				Reply::Sequence rs;
-				WaitForReply(rs, err);
+				WaitForReply(rs, util::io::After(_timeout), err);
 				if (err) {
 					return;
 				}
 			}
 				 
+			// USER and PASS go out together
 			void Login(util::error::Error &err) {
-				if (!SendCmd(CmdType::USER, err, _user)) {
-					if (!err) {
-						err = error::FtpError(error::FtpErrorCode::LOGIN_FAILED);
-					}
+				std::vector<CmdResult> results;
+				Batch(LoginCmds(), results, err);
+				if (err) {
 					return;
 				}
 
-				if (!SendCmd(CmdType::PASS, err, _pass)) {
-					if (!err) {
-						err = error::FtpError(error::FtpErrorCode::LOGIN_FAILED);
-					}
+				CheckLogin(results, err);
+			}
+
+			std::vector<Cmd> LoginCmds() const {
+				std::vector<Cmd> cmds;
+				cmds.emplace_back(CmdType::USER, _user);
+				cmds.emplace_back(CmdType::PASS, _pass);
+				return cmds;
+			}
+
+			// 230 to USER means no password was needed, the reply to PASS is then of no interest
+			void CheckLogin(const std::vector<CmdResult> &results, util::error::Error &err) const {
+				if (results[0].code == 230) {
 					return;
 				}
-			}
 
-			void Pasv(std::string &host, std::string &port, util::error::Error &err) {
-				Reply::Sequence rs;
-				if (!SendCmd(rs, CmdType::PASV, err)) {
+				if (!results[0].Positive() || !results[1].Positive()) {
+					err = error::FtpError(error::FtpErrorCode::LOGIN_FAILED);
 					return;
 				}
+			}
+
+			// TYPE, PASV and the REST of a restart go out in one write. The transfer command waits
+			// for the PASV reply: after a failed PASV a server would take it as an active-mode
+			// transfer and connect back to the default data port.
+			std::vector<Cmd> DataCmds(DataType type, uint64_t offset) const {
+				std::vector<Cmd> cmds;
+				cmds.emplace_back(CmdType::TYPE, (char)type);
+				cmds.emplace_back(CmdType::PASV);
+				if (offset > 0) {
+					cmds.emplace_back(CmdType::REST, offset);
+				}
+				return cmds;
+			}
+
+			// the first negative reply of a batch, as SendCmd reports it
+			static void CheckResults(const std::vector<CmdResult> &results, util::error::Error &err) {
+				for (auto &r : results) {
+					if (!r.Positive()) {
+						err = error::FtpError(((r.code >= 400) && (r.code < 500))
+							? error::FtpErrorCode::REPLY_TRANSIENT_NEGATIVE
+							: error::FtpErrorCode::REPLY_NEGATIVE);
+						return;
+					}
+				}
+			}
 
+			static void ParsePasv(const std::string &msg, std::string &host, std::string &port, util::error::Error &err) {
 				parser::HostPortParser parser(host, port);
-				parser.Input(rs.front()->Msg());
+				parser.Input(msg);
 				parser.Eoi();
 				if (!parser.Succeeded()) {
 					err = error::FtpError(error::FtpErrorCode::INVALID_HOST_PORT);
@@ -307,48 +802,657 @@ namespace network {
 				}
 			}
 
-			void OpenDataConnection(Tcp::Socket &conn, util::error::Error &err) {
-				std::string host;
-				std::string port;
-				Pasv(host, port, err);
+			void OpenDataConnection(Tcp::Socket &conn, DataType type, uint64_t offset, util::error::Error &err) {
+				std::vector<CmdResult> results;
+				Batch(DataCmds(type, offset), results, err);
 				if (err) {
 					return;
 				}
 
-				conn.Connect(host, port, err);
+				CheckResults(results, err);
 				if (err) {
 					return;
 				}
-			}
 
-		private:
-			util::error::Error ReadFileList(
-				std::vector<std::shared_ptr<File>> *list, 
-				Tcp::Socket *conn) {
-				util::error::Error err;
-				util::error::Error r_err = error::FtpError(error::FtpErrorCode::READ_FILE_LIST_FAILED).Error();
-				if (!list || !conn) {
-					return r_err;
+				std::string host;
+				std::string port;
+				ParsePasv(results[1].msg, host, port, err);
+				if (err) {
+					return;
 				}
 
-				size_t nread;
-				std::string buff(_buffer_size, 0);
-				network::ftp::parser::FileListParser parser(*list);
-				while (conn->IsOpen()) {
-					nread = conn->ReadSome(util::buffer::MutableBuffer::From(buff), err);
-					if (err) {
-						return err;
-					}
-
-					parser.Input(util::buffer::ConstBuffer::From(buff, nread));
-					if (parser.Failed()) {
-						return err;
-					}
+				conn.Apply(_data_profile, err);
+				if (err) {
+					return;
 				}
 
-				parser.Eoi();
-				if (!parser.Succeeded()) {
-					return r_err;
+				conn.Connect(host, port, _timeout, err);
+				if (err) {
+					return;
+				}
+			}
+
+			template<class ...Args>
+			void ListCmd(File::List &list, util::error::Error &err, const Args &...args) {
+				Tcp::Socket conn(_ctx, _protocol);
+				OpenDataConnection(conn, DataType::ASCII, 0, err);
+				if (err) {
+					return;
+				}
+
+				auto read_future = _ctx.Commit(&Client::ReadFileList, this, &list, &conn);
+
+				Reply::Sequence rs;
+				SendCmd(rs, CmdType::LIST, err, args...);
+				if (err) {
+					Cancel(conn, read_future);
+					return;
+				}
+
+				read_future.wait();
+				err = read_future.get();
+				if (err) {
+					return;
+				}
+
+				if (!WaitForReply(err)) {
+					return;
+				}
+			}
+
+			// the data connection task must not outlive conn, e.g. after a 550 the server never
+			// accepts the connection and the task would wait for data forever
+			template<class Future>
+			static void Cancel(Tcp::Socket &conn, Future &future) {
+				util::error::Error ignored;
+				conn.Shutdown(native::SHUTDOWN_BOTH, ignored);
+				future.wait();
+			}
+
+			template<class F, class Arg>
+			void Transfer(F f, Arg arg, CmdType t, const std::string &path, util::error::Error &err) {
+				Tcp::Socket conn(_ctx, _protocol);
+				OpenDataConnection(conn, DataType::IMAGE, 0, err);
+				if (err) {
+					return;
+				}
+
+				auto future = _ctx.Commit(f, this, arg, &conn);
+
+				Reply::Sequence rs;
+				SendCmd(rs, t, err, path);
+				if (err) {
+					Cancel(conn, future);
+					return;
+				}
+
+				future.wait();
+				err = future.get();
+				if (err) {
+					return;
+				}
+
+				conn.Close(err);
+				if (err) {
+					return;
+				}
+
+				if (!WaitForReply(err)) {
+					return;
+				}
+			}
+
+			// ABOR with a NOOP behind it: whatever the server answers to the transfer and to ABOR,
+			// the reply to the NOOP comes last
+			void Abort(util::error::Error &err) {
+				Cmd abor(CmdType::ABOR);
+				Cmd noop(CmdType::NOOP);
+				util::buffer::ConstBufferSequence bs = { abor.Buffer(), noop.Buffer() };
+
+				util::io::Deadline deadline = util::io::After(_timeout);
+				util::io::Write(*this, bs, deadline, err);
+				if (err) {
+					return;
+				}
+
+				Reply::Sequence rs;
+				do {
+					ReadFinalReply(rs, deadline, err);
+					if (err) {
+						return;
+					}
+				} while (rs.Code() != 200);
+			}
+
+#ifndef _WIN32
+			// a new logged-in session with the settings of this one
+			std::unique_ptr<Client> Session(util::error::Error &err) const {
+				auto c = std::make_unique<Client>(_ctx, _protocol, _server_endpoints, _user, _pass, _buffer_size);
+				c->_pool = _pool;
+				c->_control_profile = _control_profile;
+				c->_data_profile = _data_profile;
+				c->_timeout = _timeout;
+
+				c->Init(err);
+				if (err) {
+					return nullptr;
+				}
+				return c;
+			}
+
+			void SegmentedDownload(const std::string &dst_path, const std::string &src_path, uint64_t size, util::error::Error &err) {
+				int fd = ::open(dst_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+				if (fd < 0) {
+					err = util::error::IOError(util::error::IOErrorCode::OPEN_FILE_FAILED, "download");
+					return;
+				}
+
+				// the ranges are written in place, so the file gets its final size up front
+#if defined(__linux__)
+				bool allocated = (posix_fallocate(fd, 0, (off_t)size) == 0);
+#else
+				bool allocated = false;
+#endif
+				if (!allocated && (ftruncate(fd, (off_t)size) != 0)) {
+					::close(fd);
+					::unlink(dst_path.c_str());
+					err = util::error::IOError(util::error::IOErrorCode::WRITE_FAILED, "download");
+					return;
+				}
+
+				size_t n = (size_t)(std::min)((uint64_t)_segments, size / SEGMENT_MIN_SIZE);
+				uint64_t step = size / n;
+
+				std::atomic<bool> failed(false);
+				std::vector<util::error::Error> errs(n);
+				std::vector<std::thread> threads;
+				for (size_t i = 1; i < n; i++) {
+					uint64_t offset = step * i;
+					uint64_t len = (i == n - 1) ? (size - offset) : step;
+					threads.emplace_back([this, i, fd, offset, len, &src_path, &failed, &errs] {
+						auto session = Session(errs[i]);
+						if (session) {
+							session->DownloadRange(fd, src_path, offset, len, (i == errs.size() - 1), failed, util::io::Journal::NO_SLOT, errs[i]);
+							_received += session->_received;
+						}
+						if (errs[i]) {
+							failed = true;
+						}
+					});
+				}
+
+				// the first range over this session
+				DownloadRange(fd, src_path, 0, step, (n == 1), failed, util::io::Journal::NO_SLOT, errs[0]);
+				if (errs[0]) {
+					failed = true;
+				}
+
+				for (auto &t : threads) {
+					t.join();
+				}
+				::close(fd);
+
+				for (auto &e : errs) {
+					if (e) {
+						// the file has its full size but holes where ranges failed, which would pass
+						// for a complete download
+						::unlink(dst_path.c_str());
+						err = e;
+						return;
+					}
+				}
+			}
+
+			static std::string JournalKey(CmdType t, const std::string &remote, const std::string &local) {
+				std::string key(CmdTypeToText(t));
+				key += ' ';
+				key += remote;
+				key += '\0';
+				key += local;
+				return key;
+			}
+
+			// the data first, then the offset that vouches for it
+			void Checkpoint(int fd, util::io::Journal::Slot slot, uint64_t offset, util::error::Error &err) {
+#if defined(__linux__)
+				int ret = fdatasync(fd);
+#else
+				int ret = fsync(fd);
+#endif
+				if (ret != 0) {
+					err = util::error::IOError(util::error::IOErrorCode::WRITE_FAILED, "checkpoint");
+					return;
+				}
+
+				_journal->Commit(slot, offset, err);
+			}
+
+			void ResumableDownload(const std::string &dst_path, const std::string &src_path, uint64_t size, util::error::Error &err) {
+				std::string key = JournalKey(CmdType::RETR, src_path, dst_path);
+
+				// the modification time tells versions of the same size apart where the server has MDTM
+				int64_t stamp = 0;
+				Reply::Sequence rs;
+				util::error::Error mdtm_err;
+				if (SendCmd(rs, CmdType::MDTM, mdtm_err, src_path)) {
+					std::string_view msg = rs.front().Msg();
+					std::from_chars(msg.data(), msg.data() + (std::min)(msg.size(), (size_t)14), stamp);
+				}
+
+				// a record of another version of the file is of no use
+				uint64_t offset = 0;
+				util::io::Journal::Entry e;
+				if (_journal->Find(key, e) && (e.size == size) && (e.stamp == stamp) && (e.offset <= size)) {
+					offset = e.offset;
+				}
+
+				int fd = ::open(dst_path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+				if (fd < 0) {
+					err = util::error::IOError(util::error::IOErrorCode::OPEN_FILE_FAILED, "download");
+					return;
+				}
+
+				// a local file that is gone or shorter than the checkpoint was replaced or cut behind
+				// the journal's back, and padding it up to the offset would leave zeros in the result
+				struct stat st;
+				if (fstat(fd, &st) != 0) {
+					::close(fd);
+					err = util::error::IOError(util::error::IOErrorCode::READ_FAILED, "download");
+					return;
+				}
+				if ((uint64_t)st.st_size < offset) {
+					offset = 0;
+				}
+
+				auto slot = _journal->Begin(key, { offset, size, stamp }, err);
+				if (err) {
+					::close(fd);
+					return;
+				}
+
+				// what lies past the checkpoint may never have reached the disk
+				if (ftruncate(fd, (off_t)offset) != 0) {
+					::close(fd);
+					err = util::error::IOError(util::error::IOErrorCode::WRITE_FAILED, "download");
+					return;
+				}
+
+				if (offset < size) {
+					std::atomic<bool> failed(false);
+					DownloadRange(fd, src_path, offset, size - offset, true, failed, slot, err);
+				}
+
+				// also after a failure, so that the next attempt starts from here; the file ends
+				// where the last write ended
+				util::error::Error sync_err;
+				if (fstat(fd, &st) == 0) {
+					Checkpoint(fd, slot, (std::min)((uint64_t)st.st_size, size), sync_err);
+				}
+				::close(fd);
+
+				if (!err && !sync_err) {
+					_journal->End(slot, err);
+					return;
+				}
+				if (!err) {
+					err = sync_err;
+				}
+			}
+
+			void ResumableUpload(const std::string &dst_path, const std::string &src_path, util::error::Error &err) {
+				int fd = ::open(src_path.c_str(), O_RDONLY | O_CLOEXEC);
+				if (fd < 0) {
+					err = util::error::IOError(util::error::IOErrorCode::OPEN_FILE_FAILED, "upload");
+					return;
+				}
+
+				struct stat st;
+				if (fstat(fd, &st) != 0) {
+					::close(fd);
+					err = util::error::IOError(util::error::IOErrorCode::READ_FAILED, "upload");
+					return;
+				}
+				uint64_t size = (uint64_t)st.st_size;
+				int64_t stamp = (int64_t)st.st_mtime;
+
+				// the server keeps what it received, checkpointed or not; without a record of this
+				// version of the file a remote file of the same name is not ours to append to
+				std::string key = JournalKey(CmdType::STOR, dst_path, src_path);
+				uint64_t offset = 0;
+				util::io::Journal::Entry e;
+				if (_journal->Find(key, e) && (e.size == size) && (e.stamp == stamp)) {
+					uint64_t remote = 0;
+					util::error::Error size_err;
+					Size(dst_path, remote, size_err);
+					if (!size_err && (remote <= size)) {
+						offset = remote;
+					}
+				}
+
+				auto slot = _journal->Begin(key, { offset, size, stamp }, err);
+				if (err || (lseek(fd, (off_t)offset, SEEK_SET) < 0)) {
+					::close(fd);
+					if (!err) {
+						err = util::error::IOError(util::error::IOErrorCode::READ_FAILED, "upload");
+					}
+					return;
+				}
+
+				CmdType t = (offset > 0) ? CmdType::APPE : CmdType::STOR;
+#if defined(__linux__)
+				Transfer(&Client::SendFileAll, fd, t, dst_path, err);
+				::close(fd);
+#else
+				::close(fd);
+				std::ifstream is(src_path, std::ios::binary);
+				is.seekg((std::streamoff)offset);
+				Transfer(&Client::WriteAll, static_cast<std::basic_istream<char, std::char_traits<char>> *>(&is), t, dst_path, err);
+#endif
+				if (err) {
+					return;
+				}
+
+				_journal->End(slot, err);
+			}
+
+			// writes [offset, offset + size) of path at the same offset of fd; a range that does not
+			// reach the end of the file is aborted once it is complete
+			void DownloadRange(int fd,
+				const std::string &path,
+				uint64_t offset,
+				uint64_t size,
+				bool to_end,
+				const std::atomic<bool> &failed,
+				util::io::Journal::Slot slot,
+				util::error::Error &err) {
+				auto buff = _pool->Acquire(_buffer_size);
+				if (!buff) {
+					err = util::error::RuntimeError(util::error::RuntimeErrorCode::MEMORY_LIMIT_EXCEEDED);
+					return;
+				}
+
+				Tcp::Socket conn(_ctx, _protocol);
+				OpenDataConnection(conn, DataType::IMAGE, offset, err);
+				if (err) {
+					return;
+				}
+
+				Reply::Sequence rs;
+				if (!SendCmd(rs, CmdType::RETR, err, path)) {
+					return;
+				}
+
+				uint64_t done = 0;
+				uint64_t unsynced = 0;
+				while (conn.IsOpen() && (done < size) && !failed) {
+					size_t want = (size_t)(std::min)((uint64_t)buff.Size(), size - done);
+					size_t nread = conn.ReadSome(util::buffer::MutableBuffer(buff.Data(), want), util::io::After(_timeout), err);
+					if (err) {
+						break;
+					}
+
+					for (size_t nwrite = 0; nwrite < nread;) {
+						ssize_t ret = ::pwrite(fd, buff.Data() + nwrite, nread - nwrite, (off_t)(offset + done + nwrite));
+						if (ret < 0) {
+							if (errno == EINTR) {
+								continue;
+							}
+							err = util::error::IOError(util::error::IOErrorCode::WRITE_FAILED, "download");
+							break;
+						}
+						nwrite += (size_t)ret;
+					}
+					if (err) {
+						break;
+					}
+					done += nread;
+					_received += nread;
+
+					unsynced += nread;
+					if ((slot != util::io::Journal::NO_SLOT) && (unsynced >= _checkpoint)) {
+						Checkpoint(fd, slot, offset + done, err);
+						if (err) {
+							break;
+						}
+						unsynced = 0;
+					}
+				}
+
+				if (!err && (done < size) && !failed) {
+					err = error::FtpError(error::FtpErrorCode::READ_DATA_CONN_FAILED);
+				}
+
+				// the transfer reply is still to come once RETR is out, and a session left a reply
+				// behind would take it for the reply to its next command
+				if (err) {
+					util::error::Error abort_err;
+					conn.Close(abort_err);
+					Abort(abort_err);
+					return;
+				}
+
+				conn.Close(err);
+				if (err) {
+					return;
+				}
+
+				if (to_end && (done == size)) {
+					WaitForReply(err);
+					return;
+				}
+
+				Abort(err);
+			}
+#endif
+
+		private:
+#ifdef UTIL_COROUTINE
+			// tries the endpoints one after another, reopening the socket when the family changes
+			util::io::Task<> AsyncConnectAny(Tcp::Socket &s, Tcp::Resolver::Result::Ptr endpoints, util::error::Error &err) {
+				err = network::error::NetworkError(network::error::NetworkErrorCode::NO_ENDPOINT);
+				if (!endpoints) {
+					co_return;
+				}
+
+				for (auto &i : (*endpoints)) {
+					if (!i->Is(i->Family(), s.Protocol().Type(), s.Protocol().Protocol())) {
+						continue;
+					}
+
+					err = util::error::Error::None();
+					if (!s.IsOpen() || (s.Protocol().Family() != i->Family())) {
+						s.Open(Tcp::ForFamily(i->Family()), err);
+						if (err) {
+							co_return;
+						}
+					}
+
+					co_await s.AsyncConnect(i->GetEndpoint(), util::io::After(_timeout), err);
+					if (!err) {
+						co_return;
+					}
+
+					util::error::Error close_err;
+					s.Close(close_err);
+				}
+			}
+
+			util::io::Task<bool> AsyncSendCmd(Reply::Sequence &rs, Cmd c, util::error::Error &err) {
+				util::io::Deadline deadline = util::io::After(_timeout);
+				co_await util::io::AsyncWrite(*this, c.Buffer(), deadline, err);
+				if (err) {
+					co_return false;
+				}
+
+				co_await AsyncWaitForReply(rs, deadline, err);
+				co_return !err;
+			}
+
+			util::io::Task<bool> AsyncSendCmd(Cmd c, util::error::Error &err) {
+				Reply::Sequence rs;
+				co_return co_await AsyncSendCmd(rs, std::move(c), err);
+			}
+
+			util::io::Task<> AsyncWaitForReply(Reply::Sequence &rs, util::error::Error &err) {
+				return AsyncWaitForReply(rs, util::io::After(_timeout), err);
+			}
+
+			util::io::Task<> AsyncWaitForReply(Reply::Sequence &rs, util::io::Deadline deadline, util::error::Error &err) {
+				co_await AsyncReadReply(rs, deadline, err);
+				if (err) {
+					co_return;
+				}
+
+				if (!rs.Positive()) {
+					err = error::FtpError((rs.Type() == Reply::ReplyType::TRANSIENT_NEGATIVE_COMPLETION)
+						? error::FtpErrorCode::REPLY_TRANSIENT_NEGATIVE
+						: error::FtpErrorCode::REPLY_NEGATIVE);
+					co_return;
+				}
+			}
+
+			util::io::Task<> AsyncReadReply(Reply::Sequence &rs, util::io::Deadline deadline, util::error::Error &err) {
+				size_t nread;
+				while (!rs.End()) {
+					nread = co_await util::io::AsyncReadUntil(*this, _buffer, deadline, err, FTP_LINE_END);
+					if (err) {
+						co_return;
+					}
+
+					rs.Parse(_buffer.View(nread), err);
+					_buffer.Consume(nread);
+					if (err) {
+						co_return;
+					}
+				}
+			}
+
+			util::io::Task<> AsyncReadFinalReply(Reply::Sequence &rs, util::io::Deadline deadline, util::error::Error &err) {
+				do {
+					rs.Clear();
+					co_await AsyncReadReply(rs, deadline, err);
+					if (err) {
+						co_return;
+					}
+				} while (rs.Type() == Reply::ReplyType::PRELIMINARY);
+			}
+
+			// TYPE and PASV, connect, send c, run f on the data connection, then wait for the final reply
+			template<class F>
+			util::io::Task<> AsyncTransfer(Cmd c, DataType type, F f, util::error::Error &err) {
+				std::vector<CmdResult> results;
+				co_await AsyncBatch(DataCmds(type, 0), results, err);
+				if (err) {
+					co_return;
+				}
+
+				CheckResults(results, err);
+				if (err) {
+					co_return;
+				}
+
+				std::string host;
+				std::string port;
+				ParsePasv(results[1].msg, host, port, err);
+				if (err) {
+					co_return;
+				}
+
+				Tcp::Resolver resolver(_ctx);
+				auto endpoints = resolver.Resolve(host, port, err);
+				if (err) {
+					co_return;
+				}
+
+				Tcp::Socket conn(_ctx, _protocol);
+				conn.Apply(_data_profile, err);
+				if (err) {
+					co_return;
+				}
+
+				co_await AsyncConnectAny(conn, endpoints, err);
+				if (err) {
+					co_return;
+				}
+
+				co_await AsyncSendCmd(std::move(c), err);
+				if (err) {
+					co_return;
+				}
+
+				co_await f(conn, err);
+				if (err) {
+					co_return;
+				}
+
+				conn.Close(err);
+				if (err) {
+					co_return;
+				}
+
+				Reply::Sequence done;
+				co_await AsyncWaitForReply(done, err);
+			}
+
+			// hands every chunk received to f until the peer closes the connection or f returns false
+			template<class F>
+			util::io::Task<> AsyncReadData(Tcp::Socket &conn, F f, util::error::Error &err) {
+				auto buff = _pool->Acquire(_buffer_size);
+				if (!buff) {
+					err = util::error::RuntimeError(util::error::RuntimeErrorCode::MEMORY_LIMIT_EXCEEDED);
+					co_return;
+				}
+
+				for (;;) {
+					size_t nread = co_await conn.AsyncReadSome(buff.Buffer(), util::io::After(_timeout), err);
+					if (err.Is<network::error::NetworkError>(network::error::NetworkErrorCode::CLOSED)) {
+						err = util::error::Error::None();
+						co_return;
+					}
+					if (err) {
+						co_return;
+					}
+
+					if (!f(buff.Buffer(nread))) {
+						err = error::FtpError(error::FtpErrorCode::READ_DATA_CONN_FAILED);
+						co_return;
+					}
+				}
+			}
+#endif
+
+		private:
+			util::error::Error ReadFileList(
+				std::vector<std::shared_ptr<File>> *list, 
+				Tcp::Socket *conn) {
+				util::error::Error err;
+				util::error::Error r_err = error::FtpError(error::FtpErrorCode::READ_FILE_LIST_FAILED).Error();
+				if (!list || !conn) {
+					return r_err;
+				}
+
+				size_t nread;
+				auto buff = _pool->Acquire(_buffer_size);
+				if (!buff) {
+					return r_err;
+				}
+
+				network::ftp::parser::FileListParser parser(*list);
+				while (conn->IsOpen()) {
+					nread = conn->ReadSome(buff.Buffer(), util::io::After(_timeout), err);
+					if (err) {
+						return err;
+					}
+
+					parser.Input(buff.Buffer(nread));
+					if (parser.Failed()) {
+						return err;
+					}
+				}
+
+				parser.Eoi();
+				if (!parser.Succeeded()) {
+					return r_err;
 				}
 
 				return err;
@@ -364,14 +1468,46 @@ namespace network {
 				}
 
 				size_t nread;
-				std::string buff(_buffer_size, 0);
+				auto buff = _pool->Acquire(_buffer_size);
+				if (!buff) {
+					return r_err;
+				}
+
 				while (conn->IsOpen()) {
-					nread = conn->ReadSome(util::buffer::MutableBuffer::From(buff), err);
+					nread = conn->ReadSome(buff.Buffer(), util::io::After(_timeout), err);
 					if (err) {
 						return err;
 					}
 
-					os->write(buff.c_str(), nread);
+					os->write(buff.Data(), nread);
+					_received += nread;
+				}
+
+				return err;
+			}
+
+			// the chunks handed to sink share pool blocks, later reads fill the rest of a block
+			util::error::Error ReadAllTo(
+				const DataSink *sink,
+				Tcp::Socket *conn) {
+				util::error::Error err;
+				util::error::Error r_err = error::FtpError(error::FtpErrorCode::READ_DATA_CONN_FAILED).Error();
+				if (!sink || !conn) {
+					return r_err;
+				}
+
+				size_t nread;
+				util::buffer::IOBuf data(*_pool, _buffer_size);
+				while (conn->IsOpen()) {
+					nread = conn->ReadSome(data, _buffer_size, util::io::After(_timeout), err);
+					if (err) {
+						return err;
+					}
+
+					if ((nread > 0) && !(*sink)(data.Split(nread))) {
+						return r_err;
+					}
+					_received += nread;
 				}
 
 				return err;
@@ -394,14 +1530,18 @@ namespace network {
 				std::streamsize aread = endp - curp;
 
 				size_t nread = _buffer_size;
-				std::string buff(_buffer_size, 0);
+				auto buff = _pool->Acquire(_buffer_size);
+				if (!buff) {
+					return r_err;
+				}
+
 				while (conn->IsOpen() && (aread > 0)) {
 					if (aread < nread) {
 						nread = (size_t)aread;
 					}
 
-					is->read(&buff[0], nread);
-					util::io::Write(*conn, util::buffer::ConstBuffer::From(buff, nread), err);
+					is->read(buff.Data(), nread);
+					util::io::Write(*conn, buff.Buffer(nread), util::io::After(_timeout), err);
 					if (err) {
 						return err;
 					}
@@ -411,6 +1551,396 @@ namespace network {
 
 				return err;
 			}
+
+			util::error::Error WriteAllZeroCopy(
+				std::shared_ptr<const std::string> data,
+				Tcp::Socket *conn) {
+				util::error::Error err;
+				util::error::Error r_err = error::FtpError(error::FtpErrorCode::WRITE_DATA_CONN_FAILED).Error();
+				if (!data || !conn) {
+					return r_err;
+				}
+
+				auto b = util::buffer::ConstBuffer::From(*data);
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+				if ((b.Size() >= ZEROCOPY_MIN_SIZE) && conn->EnableZeroCopy(err)) {
+					while (conn->IsOpen() && (b.Size() > 0)) {
+						conn->WaitWritable(util::io::After(_timeout), err);
+						if (err) {
+							return err;
+						}
+
+						b += conn->SendZeroCopy(b, data, util::io::After(_timeout), err);
+						if (err) {
+							return err;
+						}
+					}
+
+					while (conn->ZeroCopyPending() > 0) {
+						conn->ReapZeroCopy(true, util::io::After(_timeout), err);
+						if (err) {
+							return err;
+						}
+					}
+					return err;
+				}
+#endif
+
+				util::io::Write(*conn, b, util::io::After(_timeout), err);
+				return err;
+			}
+
+#if defined(__linux__)
+			util::error::Error SendFileAll(int fd, Tcp::Socket *conn) {
+				util::error::Error err;
+				util::error::Error r_err = error::FtpError(error::FtpErrorCode::WRITE_DATA_CONN_FAILED).Error();
+				if ((fd < 0) || !conn) {
+					return r_err;
+				}
+
+				struct stat st;
+				if (fstat(fd, &st) != 0) {
+					return util::error::IOError(util::error::IOErrorCode::READ_FAILED, "upload").Error();
+				}
+
+				// from the file position on, which a resumed upload has moved
+				off_t pos = lseek(fd, 0, SEEK_CUR);
+				uint64_t offset = (pos > 0) ? (uint64_t)pos : 0;
+				uint64_t size = (uint64_t)st.st_size;
+				if (_timeout.count() > 0) {
+					conn->SetNonBlocking(true, err);
+					if (err) {
+						return err;
+					}
+				}
+				while (conn->IsOpen() && (offset < size)) {
+					size_t nwrite = conn->SendFile(fd, offset, (size_t)(size - offset), util::io::After(_timeout), err);
+					if (err) {
+						return err;
+					}
+					if (nwrite == 0) {
+						return r_err;
+					}
+				}
+
+				return err;
+			}
+
+			util::error::Error SpliceAll(int fd, Tcp::Socket *conn) {
+				util::error::Error err;
+				util::error::Error r_err = error::FtpError(error::FtpErrorCode::READ_DATA_CONN_FAILED).Error();
+				if ((fd < 0) || !conn) {
+					return r_err;
+				}
+
+				int pipefd[2];
+				if (pipe2(pipefd, O_CLOEXEC) != 0) {
+					return util::error::lib::SystemError(errno, "pipe2").Error();
+				}
+				fcntl(pipefd[1], F_SETPIPE_SZ, (int)_buffer_size);
+
+				size_t nread;
+				native::SSize nwrite;
+				while (conn->IsOpen()) {
+					conn->WaitReadable(util::io::After(_timeout), err);
+					if (err) {
+						break;
+					}
+
+					nread = conn->Splice(pipefd[1], _buffer_size, err);
+					if (err) {
+						break;
+					}
+
+					while (nread > 0) {
+						nwrite = native::Splice(pipefd[0], fd, nread);
+						if ((nwrite < 0) && (errno == EINTR)) {
+							continue;
+						}
+						if (nwrite <= 0) {
+							err = util::error::IOError(util::error::IOErrorCode::WRITE_FAILED, "download");
+							break;
+						}
+						nread -= (size_t)nwrite;
+						_received += (uint64_t)nwrite;
+					}
+					if (err) {
+						break;
+					}
+				}
+
+				::close(pipefd[0]);
+				::close(pipefd[1]);
+				return err;
+			}
+#endif
+
+#ifdef UTIL_IO_URING
+			// false without a ring, e.g. when RLIMIT_MEMLOCK does not allow the buffers to be
+			// registered, and the transfer falls back to the other engines
+			bool OpenUring() {
+				if (_uring) {
+					return true;
+				}
+
+				auto uring = std::make_unique<util::io::Uring>(URING_BUFFERS * 4);
+				if (!uring->IsOpen()) {
+					return false;
+				}
+
+				_uring_buff = _pool->Acquire(URING_BUFFERS * _buffer_size);
+				if (!_uring_buff) {
+					return false;
+				}
+
+				_uring_buffers.clear();
+				for (size_t i = 0; i < URING_BUFFERS; i++) {
+					_uring_buffers.emplace_back(_uring_buff.Data() + i * _buffer_size, _buffer_size);
+				}
+
+				util::error::Error err;
+				uring->RegisterBuffers(_uring_buffers, err);
+				if (err) {
+					_uring_buffers.clear();
+					_uring_buff = util::buffer::BufferPool::Block();
+					return false;
+				}
+
+				_uring = std::move(uring);
+				return true;
+			}
+
+			// a transfer that stops early leaves requests in flight on the ring, which must not complete
+			// into the buffers of the next one; a ring that cannot be drained is not used again
+			void DrainUring() {
+				util::error::Error err;
+				_uring->Cancel(err);
+				if (err) {
+					_uring.reset();
+				}
+			}
+
+			// one outstanding socket read; every submission carries the file write of the previous chunk
+			util::error::Error ReadAllUring(int fd, Tcp::Socket *conn) {
+				util::error::Error err;
+				util::error::Error r_err = error::FtpError(error::FtpErrorCode::READ_DATA_CONN_FAILED).Error();
+				if ((fd < 0) || !conn) {
+					return r_err;
+				}
+
+				struct Chunk {
+					uint64_t offset;
+					size_t size;
+					size_t done;
+				};
+
+				std::vector<Chunk> chunks(URING_BUFFERS);
+				std::vector<size_t> free_list;
+				for (size_t i = 0; i < URING_BUFFERS; i++) {
+					free_list.push_back(i);
+				}
+
+				int s = conn->NativeHandle();
+				uint64_t offset = 0;
+				size_t nwrite = 0;
+				bool reading = false;
+				bool eof = false;
+				util::io::Deadline deadline = util::io::NO_DEADLINE;
+				util::io::Uring::Completion c;
+				while (!eof || (nwrite > 0)) {
+					if (!eof && !reading && !free_list.empty()) {
+						size_t i = free_list.back();
+						free_list.pop_back();
+						deadline = util::io::After(_timeout);
+						_uring->PrepareReadFixed(s, _uring_buffers[i], 0, (unsigned)i, i);
+						_uring->PrepareLinkTimeout(deadline, URING_TIMEOUT);
+						reading = true;
+					}
+
+					_uring->Submit(1, err);
+					if (err) {
+						break;
+					}
+
+					while (_uring->PeekCompletion(c)) {
+						if (c.user_data == URING_TIMEOUT) {
+							continue;
+						}
+
+						size_t i = (size_t)(c.user_data & ~URING_WRITE);
+						Chunk &chunk = chunks[i];
+						if (c.user_data & URING_WRITE) {
+							--nwrite;
+							if (c.res <= 0) {
+								err = util::error::IOError(util::error::IOErrorCode::WRITE_FAILED, "download");
+								break;
+							}
+
+							chunk.done += c.res;
+							_received += (uint64_t)c.res;
+							if (chunk.done < chunk.size) {
+								auto b = util::buffer::ConstBuffer(_uring_buffers[i].Data(), chunk.size) + chunk.done;
+								_uring->PrepareWriteFixed(fd, b, chunk.offset + chunk.done, (unsigned)i, URING_WRITE | i);
+								++nwrite;
+							}
+							else {
+								free_list.push_back(i);
+							}
+							continue;
+						}
+
+						reading = false;
+						if ((c.res < 0) && ((c.res == -ECANCELED) || util::io::Expired(deadline))) {
+							err = util::error::IOError(util::error::IOErrorCode::TIMED_OUT, "download");
+							break;
+						}
+						if (c.res < 0) {
+							if ((c.res == -EINTR) || (c.res == -EAGAIN)) {
+								free_list.push_back(i);
+								continue;
+							}
+							err = util::error::lib::SocketError(-c.res);
+							break;
+						}
+						if (c.res == 0) {
+							eof = true;
+							free_list.push_back(i);
+							continue;
+						}
+
+						chunk.offset = offset;
+						chunk.size = c.res;
+						chunk.done = 0;
+						offset += c.res;
+						_uring->PrepareWriteFixed(fd, util::buffer::ConstBuffer(_uring_buffers[i].Data(), chunk.size), chunk.offset, (unsigned)i, URING_WRITE | i);
+						++nwrite;
+					}
+					if (err) {
+						break;
+					}
+				}
+
+				DrainUring();
+				return err;
+			}
+
+			// file reads run ahead on every free buffer while a single socket write drains them in order
+			util::error::Error WriteAllUring(int fd, Tcp::Socket *conn) {
+				util::error::Error err;
+				util::error::Error r_err = error::FtpError(error::FtpErrorCode::WRITE_DATA_CONN_FAILED).Error();
+				if ((fd < 0) || !conn) {
+					return r_err;
+				}
+
+				struct stat st;
+				if (fstat(fd, &st) != 0) {
+					return util::error::IOError(util::error::IOErrorCode::READ_FAILED, "upload").Error();
+				}
+
+				struct Chunk {
+					uint64_t offset;
+					size_t size;
+					size_t done;
+				};
+
+				std::vector<Chunk> chunks(URING_BUFFERS);
+				std::vector<size_t> free_list;
+				for (size_t i = 0; i < URING_BUFFERS; i++) {
+					free_list.push_back(i);
+				}
+
+				std::map<uint64_t, size_t> ready;
+				int s = conn->NativeHandle();
+				uint64_t size = (uint64_t)st.st_size;
+				uint64_t read_offset = 0;
+				uint64_t send_offset = 0;
+				bool sending = false;
+				util::io::Deadline deadline = util::io::NO_DEADLINE;
+				util::io::Uring::Completion c;
+				while (send_offset < size) {
+					while (!free_list.empty() && (read_offset < size)) {
+						size_t i = free_list.back();
+						free_list.pop_back();
+
+						Chunk &chunk = chunks[i];
+						chunk.offset = read_offset;
+						chunk.size = (size_t)(std::min<uint64_t>)(_buffer_size, size - read_offset);
+						chunk.done = 0;
+						read_offset += chunk.size;
+						_uring->PrepareReadFixed(fd, util::buffer::MutableBuffer(_uring_buffers[i].Data(), chunk.size), chunk.offset, (unsigned)i, i);
+					}
+
+					auto next = ready.find(send_offset);
+					if (!sending && (next != ready.end())) {
+						size_t i = next->second;
+						ready.erase(next);
+
+						Chunk &chunk = chunks[i];
+						auto b = util::buffer::ConstBuffer(_uring_buffers[i].Data(), chunk.size) + chunk.done;
+						deadline = util::io::After(_timeout);
+						_uring->PrepareWriteFixed(s, b, 0, (unsigned)i, URING_WRITE | i);
+						_uring->PrepareLinkTimeout(deadline, URING_TIMEOUT);
+						sending = true;
+					}
+
+					_uring->Submit(1, err);
+					if (err) {
+						break;
+					}
+
+					while (_uring->PeekCompletion(c)) {
+						if (c.user_data == URING_TIMEOUT) {
+							continue;
+						}
+
+						size_t i = (size_t)(c.user_data & ~URING_WRITE);
+						Chunk &chunk = chunks[i];
+						if (c.user_data & URING_WRITE) {
+							sending = false;
+							if ((c.res < 0) && ((c.res == -ECANCELED) || util::io::Expired(deadline))) {
+								err = util::error::IOError(util::error::IOErrorCode::TIMED_OUT, "upload");
+								break;
+							}
+							if (c.res < 0) {
+								err = util::error::lib::SocketError(-c.res);
+								break;
+							}
+
+							chunk.done += c.res;
+							if (chunk.done < chunk.size) {
+								ready[chunk.offset] = i;
+							}
+							else {
+								send_offset += chunk.size;
+								free_list.push_back(i);
+							}
+							continue;
+						}
+
+						if (c.res <= 0) {
+							err = util::error::IOError(util::error::IOErrorCode::READ_FAILED, "upload");
+							break;
+						}
+
+						chunk.done += c.res;
+						if (chunk.done < chunk.size) {
+							auto b = util::buffer::MutableBuffer(_uring_buffers[i].Data(), chunk.size) + chunk.done;
+							_uring->PrepareReadFixed(fd, b, chunk.offset + chunk.done, (unsigned)i, i);
+						}
+						else {
+							chunk.done = 0;
+							ready[chunk.offset] = i;
+						}
+					}
+					if (err) {
+						break;
+					}
+				}
+
+				DrainUring();
+				return err;
+			}
+#endif
 		};
 
 	}
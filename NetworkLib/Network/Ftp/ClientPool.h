@@ -0,0 +1,419 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+#include <Network/Protocol/Tcp.h>
+
+#include <Network/Ftp/Client.h>
+
+#include <Util/Error.h>
+#include <Util/Timer.h>
+
+namespace network {
+
+	namespace ftp {
+
+		// Logged-in control connections kept per (server endpoints, user, password). Idle
+		// connections get a NOOP when they have been quiet for the keepalive interval, are closed
+		// after the idle timeout, and are checked with a NOOP on checkout when they were idle for
+		// longer than the validation interval. The pool does not restore the working directory
+		// of a client.
+		class ClientPool {
+		public:
+			struct Stats {
+				uint64_t hits;
+				uint64_t misses;
+				uint64_t reconnects;
+				uint64_t keepalives;
+				uint64_t reaped;
+				size_t idle;
+			};
+
+			// applied to every new client before it connects, e.g. to set the transfer engine
+			using Setup = std::function<void(Client &)>;
+
+			// a checked out client, back to the pool on destruction unless discarded
+			class Lease {
+			public:
+				friend class ClientPool;
+
+			public:
+				Lease() noexcept
+					: _pool(nullptr) {}
+
+				Lease(Lease &&l) noexcept
+					: _pool(std::exchange(l._pool, nullptr)),
+					_key(std::move(l._key)),
+					_client(std::move(l._client)) {}
+
+				Lease &operator=(Lease &&l) noexcept {
+					if (this != &l) {
+						Release();
+						_pool = std::exchange(l._pool, nullptr);
+						_key = std::move(l._key);
+						_client = std::move(l._client);
+					}
+					return *this;
+				}
+
+				Lease(const Lease &) = delete;
+				Lease &operator=(const Lease &) = delete;
+
+				virtual ~Lease() {
+					Release();
+				}
+
+				Client *operator->() const noexcept {
+					return _client.get();
+				}
+
+				Client &operator*() const noexcept {
+					return *_client;
+				}
+
+				explicit operator bool() const noexcept {
+					return (_client != nullptr);
+				}
+
+				void Release() {
+					if (_client && _pool) {
+						_pool->Return(_key, std::move(_client));
+					}
+					_client.reset();
+					_pool = nullptr;
+				}
+
+				// for a client left in an unknown state, e.g. after a failed transfer
+				void Discard() noexcept {
+					_client.reset();
+					_pool = nullptr;
+				}
+
+			private:
+				ClientPool *_pool;
+				std::string _key;
+				std::unique_ptr<Client> _client;
+
+			private:
+				Lease(ClientPool *pool, std::string key, std::unique_ptr<Client> client) noexcept
+					: _pool(pool), _key(std::move(key)), _client(std::move(client)) {}
+			};
+
+		public:
+			// the pool has to outlive its leases
+			ClientPool(util::io::IOContext &ctx, const Tcp &protocol)
+				: _ctx(ctx),
+				_protocol(protocol),
+				_max_idle(4),
+				_keepalive(std::chrono::seconds(60)),
+				_idle_timeout(std::chrono::minutes(5)),
+				_validate_after(std::chrono::seconds(1)),
+				_timeout(std::chrono::seconds(30)),
+				_stopped(false),
+				_hits(0),
+				_misses(0),
+				_reconnects(0),
+				_keepalives(0),
+				_reaped(0),
+				_keeper(&ClientPool::Keep, this) {}
+
+			ClientPool(const ClientPool &) = delete;
+			ClientPool &operator=(const ClientPool &) = delete;
+
+			virtual ~ClientPool() {
+				{
+					std::lock_guard<std::mutex> lg(_mutex);
+					_stopped = true;
+				}
+				_cv.notify_all();
+				_keeper.join();
+			}
+
+			// idle connections kept per key, more are closed on return
+			void SetMaxIdle(size_t n) {
+				std::lock_guard<std::mutex> lg(_mutex);
+				_max_idle = n;
+			}
+
+			void SetKeepAlive(std::chrono::milliseconds interval) {
+				{
+					std::lock_guard<std::mutex> lg(_mutex);
+					_keepalive = interval;
+				}
+				_cv.notify_all();
+			}
+
+			void SetIdleTimeout(std::chrono::milliseconds timeout) {
+				{
+					std::lock_guard<std::mutex> lg(_mutex);
+					_idle_timeout = timeout;
+				}
+				_cv.notify_all();
+			}
+
+			// zero validates on every checkout
+			void SetValidateAfter(std::chrono::milliseconds interval) {
+				std::lock_guard<std::mutex> lg(_mutex);
+				_validate_after = interval;
+			}
+
+			// Client::SetTimeout of new clients, so that a dead server cannot stall a keepalive
+			void SetTimeout(std::chrono::milliseconds timeout) {
+				std::lock_guard<std::mutex> lg(_mutex);
+				_timeout = timeout;
+			}
+
+			void SetSetup(Setup setup) {
+				std::lock_guard<std::mutex> lg(_mutex);
+				_setup = std::move(setup);
+			}
+
+			// an idle logged-in client for the key if one is still alive, else a new one
+			Lease Acquire(const Tcp::Resolver::Result::Ptr &server_endpoints,
+				const std::string &user,
+				const std::string &pass,
+				util::error::Error &err) {
+				std::string key = Key(server_endpoints, user, pass);
+
+				bool dead = false;
+				for (;;) {
+					Idle idle;
+					std::chrono::milliseconds validate_after;
+					{
+						std::lock_guard<std::mutex> lg(_mutex);
+						auto i = _idle.find(key);
+						if ((i == _idle.end()) || i->second.empty()) {
+							break;
+						}
+
+						// the most recently used one is the most likely to be alive
+						idle = std::move(i->second.back());
+						i->second.pop_back();
+						validate_after = _validate_after;
+					}
+
+					util::error::Error noop_err;
+					if ((util::io::Clock::now() - idle.active) >= validate_after) {
+						idle.client->Noop(noop_err);
+					}
+					if (!noop_err) {
+						++_hits;
+						return Lease(this, key, std::move(idle.client));
+					}
+					dead = true;
+				}
+
+				std::unique_ptr<Client> client = Connect(server_endpoints, user, pass, err);
+				if (err) {
+					return Lease();
+				}
+
+				if (dead) {
+					++_reconnects;
+				}
+				else {
+					++_misses;
+				}
+				return Lease(this, key, std::move(client));
+			}
+
+			// closes every idle connection
+			void Clear() {
+				std::map<std::string, std::deque<Idle>> idle;
+				{
+					std::lock_guard<std::mutex> lg(_mutex);
+					idle.swap(_idle);
+				}
+			}
+
+			// the raw addresses of the endpoints, the same for every user of a server
+			static std::string HostKey(const Tcp::Resolver::Result::Ptr &server_endpoints) {
+				std::string key;
+				if (server_endpoints) {
+					for (auto &i : (*server_endpoints)) {
+						auto &ep = i->GetEndpoint();
+						key.append(reinterpret_cast<const char *>(ep.Data()), ep.Size());
+						key += '\0';
+					}
+				}
+				return key;
+			}
+
+			Stats GetStats() const {
+				std::lock_guard<std::mutex> lg(_mutex);
+				size_t idle = 0;
+				for (auto &i : _idle) {
+					idle += i.second.size();
+				}
+				return { _hits.load(), _misses.load(), _reconnects.load(), _keepalives.load(), _reaped.load(), idle };
+			}
+
+		private:
+			struct Idle {
+				std::unique_ptr<Client> client;
+				// returned to the pool
+				util::io::Deadline since;
+				// last traffic on the control connection
+				util::io::Deadline active;
+			};
+
+			util::io::IOContext &_ctx;
+			Tcp _protocol;
+
+			size_t _max_idle;
+			std::chrono::milliseconds _keepalive;
+			std::chrono::milliseconds _idle_timeout;
+			std::chrono::milliseconds _validate_after;
+			std::chrono::milliseconds _timeout;
+			Setup _setup;
+
+			mutable std::mutex _mutex;
+			std::condition_variable _cv;
+			bool _stopped;
+			std::map<std::string, std::deque<Idle>> _idle;
+
+			std::atomic<uint64_t> _hits;
+			std::atomic<uint64_t> _misses;
+			std::atomic<uint64_t> _reconnects;
+			std::atomic<uint64_t> _keepalives;
+			std::atomic<uint64_t> _reaped;
+
+			std::thread _keeper;
+
+		private:
+			// a session is only handed to callers with the same password; it is compared as is
+			// rather than hashed, so that no other password can collide with it
+			static std::string Key(const Tcp::Resolver::Result::Ptr &server_endpoints, const std::string &user, const std::string &pass) {
+				std::string key = HostKey(server_endpoints);
+				key += '\0';
+				key += user;
+				key += '\0';
+				key += pass;
+				return key;
+			}
+
+			std::unique_ptr<Client> Connect(const Tcp::Resolver::Result::Ptr &server_endpoints,
+				const std::string &user,
+				const std::string &pass,
+				util::error::Error &err) {
+				Setup setup;
+				std::chrono::milliseconds timeout;
+				{
+					std::lock_guard<std::mutex> lg(_mutex);
+					setup = _setup;
+					timeout = _timeout;
+				}
+
+				auto client = std::make_unique<Client>(_ctx, _protocol, server_endpoints, user, pass);
+				client->SetTimeout(timeout);
+				if (setup) {
+					setup(*client);
+				}
+
+				client->Init(err);
+				if (err) {
+					return nullptr;
+				}
+				return client;
+			}
+
+			void Return(const std::string &key, std::unique_ptr<Client> client) {
+				if (!client->IsOpen()) {
+					return;
+				}
+
+				util::io::Deadline now = util::io::Clock::now();
+				std::unique_ptr<Client> surplus;
+				{
+					std::lock_guard<std::mutex> lg(_mutex);
+					auto &idle = _idle[key];
+					if (_stopped || (idle.size() >= _max_idle)) {
+						surplus = std::move(client);
+					}
+					else {
+						idle.push_back({ std::move(client), now, now });
+					}
+				}
+				_cv.notify_all();
+			}
+
+			// sends the due keepalives and closes connections idle for too long
+			void Keep() {
+				std::unique_lock<std::mutex> ul(_mutex);
+				while (!_stopped) {
+					util::io::Deadline now = util::io::Clock::now();
+					util::io::Deadline next = util::io::NO_DEADLINE;
+
+					std::vector<std::pair<std::string, Idle>> due;
+					std::vector<Idle> expired;
+					for (auto i = _idle.begin(); i != _idle.end();) {
+						auto &list = i->second;
+						for (auto j = list.begin(); j != list.end();) {
+							util::io::Deadline reap = j->since + _idle_timeout;
+							util::io::Deadline ping = j->active + _keepalive;
+							if (reap <= now) {
+								expired.push_back(std::move(*j));
+								j = list.erase(j);
+							}
+							else if (ping <= now) {
+								due.emplace_back(i->first, std::move(*j));
+								j = list.erase(j);
+							}
+							else {
+								next = (std::min)(next, (std::min)(reap, ping));
+								++j;
+							}
+						}
+						i = list.empty() ? _idle.erase(i) : std::next(i);
+					}
+
+					if (expired.empty() && due.empty()) {
+						if (next == util::io::NO_DEADLINE) {
+							_cv.wait(ul);
+						}
+						else {
+							_cv.wait_until(ul, next);
+						}
+						continue;
+					}
+
+					// closed and pinged without the lock, the connections are out of the lists meanwhile
+					ul.unlock();
+					_reaped += expired.size();
+					expired.clear();
+
+					for (auto &d : due) {
+						util::error::Error err;
+						d.second.client->Noop(err);
+						++_keepalives;
+						if (err) {
+							d.second.client.reset();
+							continue;
+						}
+						d.second.active = util::io::Clock::now();
+					}
+					ul.lock();
+
+					for (auto &d : due) {
+						if (d.second.client && !_stopped) {
+							_idle[d.first].push_back(std::move(d.second));
+						}
+					}
+				}
+			}
+		};
+
+	}
+
+}
\ No newline at end of file
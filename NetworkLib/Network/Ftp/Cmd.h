@@ -1,6 +1,13 @@
 #pragma once
 
-#include <unordered_map>
+#include <memory>
+#include <cstring>
+#include <charconv>
+#include <string_view>
+#include <type_traits>
+
+#include <Util/Error.h>
+#include <Util/Buffer.h>
 
 namespace network {
 
@@ -40,69 +47,145 @@ namespace network {
 			SYST,
 			STAT,
 			HELP,
-			NOOP
+			NOOP,
+			SIZE,
+			MDTM
 		};
 
-		const std::unordered_map<CmdType, std::string> CMD_TEXT_TABLE = {
-			{ CmdType::BAD, "BAD" },
-			{ CmdType::USER, "USER" },
-			{ CmdType::PASS, "PASS" },
-			{ CmdType::ACCT, "ACCT" },
-			{ CmdType::CWD,  "CWD" },
-			{ CmdType::CDUP, "CDUP" },
-			{ CmdType::SMNT, "SMNT" },
-			{ CmdType::REIN, "REIN" },
-			{ CmdType::QUIT, "QUIT" },
-			{ CmdType::PORT, "PORT" },
-			{ CmdType::PASV, "PASV" },
-			{ CmdType::TYPE, "TYPE" },
-			{ CmdType::STRU, "STRU" },
-			{ CmdType::MODE, "MODE" },
-			{ CmdType::RETR, "RETR" },
-			{ CmdType::STOR, "STOR" },
-			{ CmdType::STOU, "STOU" },
-			{ CmdType::APPE, "APPE" },
-			{ CmdType::ALLO, "ALLO" },
-			{ CmdType::REST, "REST" },
-			{ CmdType::RNFR, "RNFR" },
-			{ CmdType::RNTO, "RNTO" },
-			{ CmdType::ABOR, "ABOR" },
-			{ CmdType::DELE, "DELE" },
-			{ CmdType::RMD,  "RMD" },
-			{ CmdType::MKD,  "MKD" },
-			{ CmdType::PWD,  "PWD" },
-			{ CmdType::LIST, "LIST" },
-			{ CmdType::NLST, "NLST" },
-			{ CmdType::SITE, "SITE" },
-			{ CmdType::SYST, "SYST" },
-			{ CmdType::STAT, "STAT" },
-			{ CmdType::HELP, "HELP" },
-			{ CmdType::NOOP, "NOOP" }
+		// verbs in CmdType order
+		constexpr std::string_view CMD_TEXT_TABLE[] = {
+			"BAD",
+			"USER",
+			"PASS",
+			"ACCT",
+			"CWD",
+			"CDUP",
+			"SMNT",
+			"REIN",
+			"QUIT",
+			"PORT",
+			"PASV",
+			"TYPE",
+			"STRU",
+			"MODE",
+			"RETR",
+			"STOR",
+			"STOU",
+			"APPE",
+			"ALLO",
+			"REST",
+			"RNFR",
+			"RNTO",
+			"ABOR",
+			"DELE",
+			"RMD",
+			"MKD",
+			"PWD",
+			"LIST",
+			"NLST",
+			"SITE",
+			"SYST",
+			"STAT",
+			"HELP",
+			"NOOP",
+			"SIZE",
+			"MDTM"
 		};
 
-		static const std::string &CmdTypeToText(CmdType t) {
-			auto i = CMD_TEXT_TABLE.find(t);
-			if (i == CMD_TEXT_TABLE.end()) {
-				i = CMD_TEXT_TABLE.find(CmdType::BAD);
-			}
-			return i->second;
+		static_assert((sizeof(CMD_TEXT_TABLE) / sizeof(CMD_TEXT_TABLE[0])) == ((size_t)CmdType::MDTM + 1), "CMD_TEXT_TABLE out of sync with CmdType");
+
+		constexpr std::string_view CmdTypeToText(CmdType t) noexcept {
+			size_t i = (size_t)t;
+			return (i < (sizeof(CMD_TEXT_TABLE) / sizeof(CMD_TEXT_TABLE[0]))) ? CMD_TEXT_TABLE[i] : CMD_TEXT_TABLE[0];
+		}
+
+		namespace detail {
+
+			// appends to a fixed buffer as long as everything fits and counts the bytes either way
+			class CmdWriter {
+			public:
+				CmdWriter(char *out, size_t capacity) noexcept
+					: _out(out), _capacity(capacity), _size(0) {}
+
+				void Put(std::string_view s) noexcept {
+					if ((_size + s.size()) <= _capacity) {
+						std::memcpy(_out + _size, s.data(), s.size());
+					}
+					_size += s.size();
+				}
+
+				void Put(char c) noexcept {
+					if (_size < _capacity) {
+						_out[_size] = c;
+					}
+					++_size;
+				}
+
+				template<class T, class = std::enable_if_t<std::is_integral_v<T>>>
+				void Put(T v) noexcept {
+					char tmp[24];
+					auto r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+					Put(std::string_view(tmp, (size_t)(r.ptr - tmp)));
+				}
+
+				size_t Size() const noexcept {
+					return _size;
+				}
+
+			private:
+				char *_out;
+				size_t _capacity;
+				size_t _size;
+			};
+
 		}
 
+		// writes "VERB arg ...\r\n" to out if it fits in capacity, returns the size of the line either way
+		template<class ...Args>
+		size_t EncodeCmd(char *out, size_t capacity, CmdType t, const Args &...args) noexcept {
+			detail::CmdWriter w(out, capacity);
+			w.Put(CmdTypeToText(t));
+			((w.Put(' '), w.Put(args)), ...);
+			w.Put(std::string_view("\r\n"));
+			return w.Size();
+		}
+
+		// An encoded command line. Lines up to INLINE_SIZE bytes, which is all but the longest
+		// paths, are kept in the command itself.
 		class Cmd {
+		public:
+			static const size_t INLINE_SIZE = 256;
+
 		public:
 			Cmd() noexcept
-				: _t(CmdType::BAD) {}
+				: _t(CmdType::BAD), _size(0) {}
 
 			template<class ...Args>
-			Cmd(CmdType t, Args &&...args) noexcept
+			Cmd(CmdType t, const Args &...args)
 				: _t(t) {
-				util::string::JoinSpace(_s, CmdTypeToText(t), std::forward<Args>(args)...);
-				_s += "\r\n";
+				_size = EncodeCmd(_inline, INLINE_SIZE, t, args...);
+				if (_size > INLINE_SIZE) {
+					_heap.reset(new char[_size]);
+					EncodeCmd(_heap.get(), _size, t, args...);
+				}
+			}
+
+			Cmd(Cmd &&c) noexcept
+				: _t(c._t), _size(c._size), _heap(std::move(c._heap)) {
+				if (!_heap) {
+					std::memcpy(_inline, c._inline, _size);
+				}
 			}
 
-			Cmd &operator=(Cmd &&c) {
-				_t = std::move(c._t);
-				_s = std::move(c._s);
+			Cmd &operator=(Cmd &&c) noexcept {
+				if (this != &c) {
+					_t = c._t;
+					_size = c._size;
+					_heap = std::move(c._heap);
+					if (!_heap) {
+						std::memcpy(_inline, c._inline, _size);
+					}
+				}
 				return *this;
 			}
 
@@ -110,13 +193,24 @@ namespace network {
 				return _t;
 			}
 
-			const std::string &Str() const noexcept {
-				return _s;
+			std::string_view Str() const noexcept {
+				return std::string_view(Data(), _size);
+			}
+
+			util::buffer::ConstBuffer Buffer() const noexcept {
+				return util::buffer::ConstBuffer(Data(), _size);
 			}
 
 		private:
 			CmdType _t;
-			std::string _s;
+			size_t _size;
+			char _inline[INLINE_SIZE];
+			std::unique_ptr<char[]> _heap;
+
+		private:
+			const char *Data() const noexcept {
+				return _heap ? _heap.get() : _inline;
+			}
 		};
 
 	}
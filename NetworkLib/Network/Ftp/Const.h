@@ -2,12 +2,17 @@
 
 #include <string>
 
+#include <Util/String.h>
+
 namespace network {
 
 	namespace ftp {
 
 		const std::string FTP_ANONYMOUS("anonymous");
 
+		// control replies are CRLF terminated, bare LF is accepted as well
+		constexpr auto FTP_LINE_END = util::string::MakeMatcher("\r\n", "\n");
+
 	}
 
 }
\ No newline at end of file
@@ -15,6 +15,7 @@ namespace network {
 				REPLY_BAD_CODE,
 				REPLY_BAD_MSG,
 				REPLY_NEGATIVE,
+				REPLY_TRANSIENT_NEGATIVE,
 
 				CWD_FAILED,
 				LOGIN_FAILED,
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <map>
+#include <ctime>
+#include <mutex>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <system_error>
+#include <condition_variable>
+
+#include <Network/Protocol/Tcp.h>
+
+#include <Network/Ftp/Type.h>
+#include <Network/Ftp/Error.h>
+#include <Network/Ftp/Client.h>
+#include <Network/Ftp/ClientPool.h>
+#include <Network/Ftp/TransferManager.h>
+
+#include <Util/Error.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+namespace network {
+
+	namespace ftp {
+
+		// Makes a local directory tree a copy of a remote one. Directories are listed in parallel
+		// over listers sessions, and a file is downloaded only when the local one differs in size
+		// or modification time from its listing; downloaded files get the listed time, so that
+		// the next run skips them. Local entries missing remotely are kept, links are skipped.
+		class Mirror {
+		public:
+			struct Stats {
+				uint64_t dirs;
+				uint64_t files;
+				uint64_t unchanged;
+				uint64_t transferred;
+				uint64_t bytes;
+				uint64_t failed;
+			};
+
+		public:
+			// pool has to outlive the mirror
+			Mirror(ClientPool &pool, size_t listers = 4, size_t transfers = 4)
+				: _pool(pool),
+				_listers((std::max)(listers, (size_t)1)),
+				_transfers((std::max)(transfers, (size_t)1)) {}
+
+			Mirror(const Mirror &) = delete;
+			Mirror &operator=(const Mirror &) = delete;
+
+			virtual ~Mirror() {}
+
+			// err is the first failure, the rest of the tree is mirrored anyway
+			void Run(const Tcp::Resolver::Result::Ptr &server_endpoints,
+				const std::string &user,
+				const std::string &pass,
+				const std::string &remote_dir,
+				const std::string &local_dir,
+				Stats &stats,
+				util::error::Error &err) {
+				Walk walk(server_endpoints, user, pass);
+				walk.dirs.push_back({ remote_dir, fs::path(local_dir) });
+
+				TransferManager tm(_pool, _transfers, _transfers);
+				tm.SetCallback([&walk](const TransferManager::Result &r) {
+					util::error::Error stamp_err;
+					if (!r.err) {
+						Stamp(r.job.local_path, walk.Time(r.job.local_path), stamp_err);
+					}
+					walk.Done(r, r.err ? r.err : stamp_err);
+				});
+
+				std::vector<std::thread> listers;
+				for (size_t i = 0; i < _listers; i++) {
+					listers.emplace_back(&Mirror::List, this, std::ref(walk), std::ref(tm));
+				}
+				for (auto &t : listers) {
+					t.join();
+				}
+				tm.Wait();
+
+				std::lock_guard<std::mutex> lg(walk.mutex);
+				stats = walk.stats;
+				err = walk.err;
+			}
+
+		private:
+			struct Dir {
+				std::string remote;
+				fs::path local;
+			};
+
+			// state of one Run shared by the listers and the transfer callback
+			struct Walk {
+				Tcp::Resolver::Result::Ptr server;
+				std::string user;
+				std::string pass;
+
+				std::mutex mutex;
+				std::condition_variable cv;
+				std::deque<Dir> dirs;
+				// listers working on a directory, which may add more
+				size_t busy = 0;
+				// listed time of the files being downloaded, by local path; recorded before
+				// the job is submitted, so that it is in place when the callback runs
+				std::map<std::string, time_t> times;
+				Stats stats = {};
+				util::error::Error err;
+
+				Walk(const Tcp::Resolver::Result::Ptr &s, const std::string &u, const std::string &p)
+					: server(s), user(u), pass(p) {}
+
+				time_t Time(const std::string &local) {
+					std::lock_guard<std::mutex> lg(mutex);
+					auto i = times.find(local);
+					if (i == times.end()) {
+						return 0;
+					}
+
+					time_t t = i->second;
+					times.erase(i);
+					return t;
+				}
+
+				void Done(const TransferManager::Result &r, const util::error::Error &e) {
+					std::lock_guard<std::mutex> lg(mutex);
+					if (e) {
+						Fail(e);
+						return;
+					}
+					++stats.transferred;
+					stats.bytes += r.job.size;
+				}
+
+				// under the lock
+				void Fail(const util::error::Error &e) {
+					++stats.failed;
+					if (!err) {
+						err = e;
+					}
+				}
+			};
+
+			ClientPool &_pool;
+			size_t _listers;
+			size_t _transfers;
+
+		private:
+			void List(Walk &walk, TransferManager &tm) {
+				ClientPool::Lease lease;
+				std::unique_lock<std::mutex> ul(walk.mutex);
+				for (;;) {
+					walk.cv.wait(ul, [&walk] {
+						return !walk.dirs.empty() || (walk.busy == 0);
+					});
+					if (walk.dirs.empty()) {
+						return;
+					}
+
+					Dir dir = std::move(walk.dirs.front());
+					walk.dirs.pop_front();
+					++walk.busy;
+					ul.unlock();
+
+					util::error::Error err;
+					File::List list;
+					if (!lease) {
+						lease = _pool.Acquire(walk.server, walk.user, walk.pass, err);
+					}
+					if (!err) {
+						lease->List(dir.remote, list, err);
+						if (err && !err.Is<error::FtpError>(error::FtpErrorCode::REPLY_NEGATIVE)) {
+							lease.Discard();
+						}
+					}
+
+					std::error_code ec;
+					if (!err) {
+						fs::create_directories(dir.local, ec);
+						if (ec) {
+							err = util::error::IOError(util::error::IOErrorCode::WRITE_FAILED, "mirror");
+						}
+					}
+
+					std::vector<Dir> subdirs;
+					std::vector<TransferManager::Job> jobs;
+					std::vector<time_t> times;
+					size_t files = 0;
+					size_t unchanged = 0;
+					for (auto &f : list) {
+						if ((f->name == ".") || (f->name == "..")) {
+							continue;
+						}
+
+						std::string remote = Join(dir.remote, f->name);
+						fs::path local = dir.local / f->name;
+						if (IsDirectory(f.get())) {
+							subdirs.push_back({ std::move(remote), std::move(local) });
+							continue;
+						}
+						if (f->type != fs::file_type::regular) {
+							continue;
+						}
+
+						++files;
+						if (Unchanged(local, *f)) {
+							++unchanged;
+							continue;
+						}
+
+						jobs.push_back({ TransferManager::Direction::GET, walk.server, walk.user, walk.pass, std::move(remote), local.string(), f->size });
+						times.push_back(f->last_mod_time);
+					}
+
+					ul.lock();
+					++walk.stats.dirs;
+					walk.stats.files += files;
+					walk.stats.unchanged += unchanged;
+					if (err) {
+						walk.Fail(err);
+					}
+					for (size_t i = 0; i < jobs.size(); ++i) {
+						walk.times[jobs[i].local_path] = times[i];
+					}
+					for (auto &d : subdirs) {
+						walk.dirs.push_back(std::move(d));
+					}
+					walk.cv.notify_all();
+					ul.unlock();
+
+					for (auto &job : jobs) {
+						tm.Submit(std::move(job));
+					}
+
+					// still busy until the jobs are in, or Run could reach tm.Wait before them
+					ul.lock();
+					--walk.busy;
+					walk.cv.notify_all();
+				}
+			}
+
+			static std::string Join(const std::string &dir, const std::string &name) {
+				if (!dir.empty() && (dir.back() == '/')) {
+					return dir + name;
+				}
+				return dir + "/" + name;
+			}
+
+			static bool Unchanged(const fs::path &local, const File &remote) {
+				struct stat st;
+				if (::stat(local.string().c_str(), &st) != 0) {
+					return false;
+				}
+				return ((uint64_t)st.st_size == remote.size) && (st.st_mtime == remote.last_mod_time);
+			}
+
+			static void Stamp(const std::string &path, time_t t, util::error::Error &err) {
+#ifdef _WIN32
+				struct _utimbuf times = { t, t };
+				int ret = _utime(path.c_str(), &times);
+#else
+				struct utimbuf times = { t, t };
+				int ret = utime(path.c_str(), &times);
+#endif
+				if (ret != 0) {
+					err = util::error::IOError(util::error::IOErrorCode::WRITE_FAILED, "mirror");
+				}
+			}
+		};
+
+	}
+
+}
\ No newline at end of file
@@ -2,12 +2,14 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <algorithm>
 
 #include <Network/Ftp/Error.h>
 
 #include <Util/Error.h>
+#include <Util/Arena.h>
 
 namespace network {
 
@@ -24,38 +26,25 @@ namespace network {
 				PERMANENT_NEGATIVE_COMPLETION,
 			};
 
-			using Ptr = std::shared_ptr<Reply>;
 			class Sequence;
 
+			friend class Sequence;
+
 		public:
 			Reply() noexcept
 				: _code(0), _last(true) {}
 
-			void Parse(const std::string &s, util::error::Error &err) noexcept {
-				size_t size = s.size();
-				err = error::FtpError(error::FtpErrorCode::REPLY_BAD_CODE);
-				if (size < 3) {
-					return;
-				}
-
-				if (!std::all_of(s.begin() + 1, s.begin() + 3, isdigit)) {
-					return;
-				}
-
-				if ((s[0] < '1') || (s[1] > '5')) {
+			// s is one reply line, "ddd text" or "ddd-text" for the first lines of a multiline reply;
+			// Msg refers into s afterwards
+			void Parse(std::string_view s, util::error::Error &err) noexcept {
+				if (!Valid(s)) {
+					err = error::FtpError(error::FtpErrorCode::REPLY_BAD_CODE);
 					return;
 				}
 
-				if ((size >= 4) && (s[3] != ' ') && (s[3] != '-')) {
-					return;
-				}
-
-				if ((size > 4) && (s[3] == '-')) {
-					_last = false;
-				}
-
-				_msg = s.substr(4);
-				_code = (uint16_t)std::stoi(s.substr(0, 3));
+				_last = !((s.size() > 4) && (s[3] == '-'));
+				_msg = (s.size() > 4) ? s.substr(4) : std::string_view();
+				_code = Number(s);
 
 				err = error::Error();
 				return;
@@ -69,7 +58,7 @@ namespace network {
 				return _code;
 			}
 
-			const std::string &Msg() const noexcept {
+			std::string_view Msg() const noexcept {
 				return _msg;
 			}
 
@@ -90,62 +79,160 @@ namespace network {
 		private:
 			bool _last;
 			uint16_t _code;
-			std::string _msg;
+			std::string_view _msg;
+
+		private:
+			static bool Valid(std::string_view s) noexcept {
+				if (s.size() < 3) {
+					return false;
+				}
+
+				if (!std::all_of(s.begin(), s.begin() + 3, isdigit)) {
+					return false;
+				}
+
+				if ((s[0] < '1') || (s[0] > '5')) {
+					return false;
+				}
+
+				return (s.size() == 3) || (s[3] == ' ') || (s[3] == '-');
+			}
+
+			static uint16_t Number(std::string_view s) noexcept {
+				return (uint16_t)((s[0] - '0') * 100 + (s[1] - '0') * 10 + (s[2] - '0'));
+			}
+
+			// free text inside a multiline reply
+			void Continue(std::string_view s, uint16_t code) noexcept {
+				_last = false;
+				_code = code;
+				_msg = s;
+			}
 		};
 
-		class Reply::Sequence : public std::vector<Reply::Ptr> {
+		// The lines of one reply. The first line and up to INLINE_TEXT bytes of text live in the
+		// sequence itself, which covers single line replies; the text of longer multiline replies
+		// (FEAT, STAT, HELP) goes to an arena. Replies refer into that storage, so a sequence
+		// is neither copied nor moved.
+		class Reply::Sequence {
+		public:
+			static const size_t INLINE_TEXT = 128;
+
 		public:
-			explicit Sequence() noexcept {}
+			explicit Sequence() noexcept
+				: _size(0), _text_used(0), _arena(2048) {}
+
+			Sequence(const Sequence &) = delete;
+			Sequence &operator=(const Sequence &) = delete;
 
 			~Sequence() {}
 
-			void Parse(const std::string &s, util::error::Error &err) noexcept {
-				auto r = std::make_shared<Reply>();
-				r->Parse(s, err);
-				if (err) {
-					return;
+			void Parse(std::string_view s, util::error::Error &err) noexcept {
+				char *text = Store(s.size());
+				std::copy(s.begin(), s.end(), text);
+
+				// inside a multiline reply only a line with the same code is parsed, and only the
+				// one with a space after the code ends it
+				std::string_view line(text, s.size());
+				Reply r;
+				if ((_size > 0) && !back().Last() && !(Reply::Valid(line) && (Reply::Number(line) == _first.Code()))) {
+					r.Continue(line, _first.Code());
+				}
+				else {
+					r.Parse(line, err);
+					if (err) {
+						return;
+					}
 				}
 
-				push_back(r);
+				if (_size == 0) {
+					_first = r;
+				}
+				else {
+					_more.push_back(r);
+				}
+				++_size;
 			}
 
 			void Clear() noexcept {
-				clear();
+				_size = 0;
+				_text_used = 0;
+				_more.clear();
+				_arena.Clear();
+			}
+
+			size_t size() const noexcept {
+				return _size;
+			}
+
+			bool empty() const noexcept {
+				return (_size == 0);
+			}
+
+			const Reply &operator[](size_t i) const noexcept {
+				return (i == 0) ? _first : _more[i - 1];
+			}
+
+			const Reply &front() const noexcept {
+				return _first;
+			}
+
+			const Reply &back() const noexcept {
+				return (*this)[_size - 1];
 			}
 
 			Reply::ReplyType Type() const noexcept {
 				if (size() == 0) {
 					return ReplyType::BAD;
 				}
-				return front()->Type();
+				return front().Type();
 			}
 
 			uint16_t Code() const noexcept {
 				if (size() == 0) {
 					return 0;
 				}
-				return front()->Code();
+				return front().Code();
 			}
 
 			bool End() const noexcept {
 				if (size() == 0) {
 					return false;
 				}
-				return back()->Last();
+				return back().Last();
 			}
 
 			bool Positive() const noexcept {
 				if (size() == 0) {
 					return false;
 				}
-				return front()->Positive();
+				return front().Positive();
 			}
 
 			bool Negative() const noexcept {
 				if (size() == 0) {
 					return false;
 				}
-				return front()->Negative();
+				return front().Negative();
+			}
+
+		private:
+			Reply _first;
+			std::vector<Reply> _more;
+			size_t _size;
+
+			char _text[INLINE_TEXT];
+			size_t _text_used;
+			util::buffer::Arena _arena;
+
+		private:
+			char *Store(size_t n) {
+				if ((INLINE_TEXT - _text_used) >= n) {
+					char *p = _text + _text_used;
+					_text_used += n;
+					return p;
+				}
+				return _arena.Allocate(n);
 			}
 		};
 
@@ -0,0 +1,458 @@
+#pragma once
+
+#include <map>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+#include <Network/Protocol/Tcp.h>
+
+#include <Network/Ftp/Error.h>
+#include <Network/Ftp/Client.h>
+#include <Network/Ftp/ClientPool.h>
+
+#include <Util/Error.h>
+#include <Util/Timer.h>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+namespace network {
+
+	namespace ftp {
+
+		// Runs queued downloads and uploads over sessions leased from a ClientPool. At most
+		// max_sessions jobs run at once, at most max_per_host of them against one server; hosts
+		// take turns. Failed jobs are retried with exponential backoff unless the failure is
+		// permanent: a negative 5xx reply, a rejected login or a local file that cannot be opened.
+		// Queued jobs run in submission order with retries first, or smallest first, see SetOrder.
+		class TransferManager {
+		public:
+			enum class Direction {
+				GET = 0,
+				PUT,
+			};
+
+			// which queued job runs next
+			enum class Order {
+				FIFO = 0,
+				// smallest size first, unknown sizes last, but a job that has waited for max_wait
+				// runs before any younger one. Across hosts the smallest eligible job wins.
+				SHORTEST_FIRST,
+			};
+
+			using JobId = uint64_t;
+
+			static constexpr uint64_t UNKNOWN_SIZE = (uint64_t)-1;
+
+			struct Job {
+				Direction direction;
+				Tcp::Resolver::Result::Ptr server;
+				std::string user;
+				std::string pass;
+				std::string remote_path;
+				std::string local_path;
+				// e.g. File::size from a listing or Client::Size, a PUT defaults to the local size
+				uint64_t size = UNKNOWN_SIZE;
+			};
+
+			struct Result {
+				JobId id;
+				Job job;
+				util::error::Error err;
+				size_t attempts;
+				std::chrono::milliseconds elapsed;
+			};
+
+			struct Stats {
+				size_t queued;
+				size_t running;
+				uint64_t succeeded;
+				uint64_t failed;
+				uint64_t retries;
+			};
+
+			// called on a worker thread once a job has succeeded or given up
+			using Callback = std::function<void(const Result &)>;
+
+		public:
+			// pool has to outlive the manager
+			TransferManager(ClientPool &pool, size_t max_sessions = 8, size_t max_per_host = 2)
+				: _pool(pool),
+				_max_per_host((std::max)(max_per_host, (size_t)1)),
+				_max_attempts(3),
+				_backoff(std::chrono::milliseconds(500)),
+				_max_backoff(std::chrono::seconds(30)),
+				_order(Order::FIFO),
+				_max_wait(std::chrono::seconds(60)),
+				_next_id(1),
+				_unfinished(0),
+				_running(0),
+				_succeeded(0),
+				_failed(0),
+				_retries(0),
+				_stopped(false) {
+				for (size_t i = 0; i < (std::max)(max_sessions, (size_t)1); i++) {
+					_workers.emplace_back(&TransferManager::Work, this);
+				}
+			}
+
+			TransferManager(const TransferManager &) = delete;
+			TransferManager &operator=(const TransferManager &) = delete;
+
+			// running jobs finish, queued ones are reported as aborted
+			virtual ~TransferManager() {
+				{
+					std::lock_guard<std::mutex> lg(_mutex);
+					_stopped = true;
+				}
+				_cv.notify_all();
+				for (auto &t : _workers) {
+					t.join();
+				}
+			}
+
+			// max_attempts counts the first one, the delay doubles per retry up to max_backoff
+			void SetRetry(size_t max_attempts, std::chrono::milliseconds backoff, std::chrono::milliseconds max_backoff) {
+				std::lock_guard<std::mutex> lg(_mutex);
+				_max_attempts = (std::max)(max_attempts, (size_t)1);
+				_backoff = backoff;
+				_max_backoff = max_backoff;
+			}
+
+			void SetOrder(Order order, std::chrono::milliseconds max_wait = std::chrono::seconds(60)) {
+				{
+					std::lock_guard<std::mutex> lg(_mutex);
+					_order = order;
+					_max_wait = max_wait;
+				}
+				_cv.notify_all();
+			}
+
+			void SetCallback(Callback callback) {
+				std::lock_guard<std::mutex> lg(_mutex);
+				_callback = std::move(callback);
+			}
+
+			JobId Submit(Job job) {
+#ifndef _WIN32
+				struct stat st;
+				if ((job.direction == Direction::PUT) && (job.size == UNKNOWN_SIZE) && (::stat(job.local_path.c_str(), &st) == 0)) {
+					job.size = (uint64_t)st.st_size;
+				}
+#endif
+
+				JobId id;
+				{
+					std::lock_guard<std::mutex> lg(_mutex);
+					id = _next_id++;
+					std::string host = ClientPool::HostKey(job.server);
+					Push(_hosts[host], { id, std::move(job), 0, util::io::Clock::now() }, false);
+					++_unfinished;
+				}
+				_cv.notify_one();
+				return id;
+			}
+
+			// until every job submitted so far has succeeded or given up
+			void Wait() {
+				std::unique_lock<std::mutex> ul(_mutex);
+				_done_cv.wait(ul, [this] {
+					return (_unfinished == 0);
+				});
+			}
+
+			// the results so far, in the order the jobs finished
+			std::vector<Result> Results() const {
+				std::lock_guard<std::mutex> lg(_mutex);
+				return _results;
+			}
+
+			Stats GetStats() const {
+				std::lock_guard<std::mutex> lg(_mutex);
+				size_t queued = _delayed.size();
+				for (auto &h : _hosts) {
+					queued += h.second.queue.size();
+				}
+				return { queued, _running, _succeeded, _failed, _retries };
+			}
+
+		private:
+			struct Pending {
+				JobId id;
+				Job job;
+				size_t attempts;
+				util::io::Deadline submitted;
+			};
+
+			struct Host {
+				size_t active = 0;
+				// in submission order, retries in front
+				std::list<Pending> queue;
+				// the same jobs by (size, id)
+				std::map<std::pair<uint64_t, JobId>, std::list<Pending>::iterator> by_size;
+				// and by (submitted, id), which a retry in front of the queue does not hide
+				std::map<std::pair<util::io::Deadline, JobId>, std::list<Pending>::iterator> by_age;
+			};
+
+			ClientPool &_pool;
+			size_t _max_per_host;
+			size_t _max_attempts;
+			std::chrono::milliseconds _backoff;
+			std::chrono::milliseconds _max_backoff;
+			Order _order;
+			std::chrono::milliseconds _max_wait;
+			Callback _callback;
+
+			mutable std::mutex _mutex;
+			std::condition_variable _cv;
+			std::condition_variable _done_cv;
+
+			JobId _next_id;
+			std::map<std::string, Host> _hosts;
+			// waiting out a backoff, by the time they may run again
+			std::multimap<util::io::Deadline, std::pair<std::string, Pending>> _delayed;
+			// the host served last, the next pick starts after it
+			std::string _last_host;
+
+			size_t _unfinished;
+			size_t _running;
+			uint64_t _succeeded;
+			uint64_t _failed;
+			uint64_t _retries;
+			std::vector<Result> _results;
+			bool _stopped;
+
+			std::vector<std::thread> _workers;
+
+		private:
+			static bool Retriable(const util::error::Error &err) noexcept {
+				return !err.Is<error::FtpError>(error::FtpErrorCode::REPLY_NEGATIVE)
+					&& !err.Is<error::FtpError>(error::FtpErrorCode::LOGIN_FAILED)
+					&& !err.Is<util::error::IOError>(util::error::IOErrorCode::OPEN_FILE_FAILED);
+			}
+
+			void Work() {
+				std::unique_lock<std::mutex> ul(_mutex);
+				for (;;) {
+					util::io::Deadline next = util::io::NO_DEADLINE;
+					std::string host;
+					Pending p;
+					if (!_stopped && Pick(host, p, next)) {
+						++_hosts[host].active;
+						++_running;
+						ul.unlock();
+
+						util::error::Error err;
+						++p.attempts;
+						Run(p.job, err);
+
+						ul.lock();
+						--_running;
+						Host &h = _hosts[host];
+						if ((--h.active == 0) && h.queue.empty()) {
+							_hosts.erase(host);
+						}
+						Finish(ul, host, std::move(p), err);
+						_cv.notify_all();
+						continue;
+					}
+
+					if (_stopped) {
+						Abort(ul);
+						return;
+					}
+
+					if (next == util::io::NO_DEADLINE) {
+						_cv.wait(ul);
+					}
+					else {
+						_cv.wait_until(ul, next);
+					}
+				}
+			}
+
+			// the next job of the first host after the last one served that is below its limit;
+			// next becomes the earliest end of a backoff if there is no such job
+			bool Pick(std::string &host, Pending &p, util::io::Deadline &next) {
+				util::io::Deadline now = util::io::Clock::now();
+				while (!_delayed.empty() && (_delayed.begin()->first <= now)) {
+					auto &d = _delayed.begin()->second;
+					Push(_hosts[d.first], std::move(d.second), true);
+					_delayed.erase(_delayed.begin());
+				}
+				if (!_delayed.empty()) {
+					next = _delayed.begin()->first;
+				}
+
+				if (_hosts.empty()) {
+					return false;
+				}
+
+				auto chosen = _hosts.end();
+				std::list<Pending>::iterator job;
+				if (_order == Order::SHORTEST_FIRST) {
+					util::io::Deadline aged = now - _max_wait;
+					for (auto i = _hosts.begin(); i != _hosts.end(); ++i) {
+						Host &h = i->second;
+						if (h.queue.empty() || (h.active >= _max_per_host)) {
+							continue;
+						}
+
+						auto oldest = h.by_age.begin()->second;
+						auto candidate = (oldest->submitted <= aged) ? oldest : h.by_size.begin()->second;
+						if ((chosen == _hosts.end()) || Before(*candidate, *job, aged)) {
+							chosen = i;
+							job = candidate;
+						}
+					}
+				}
+				else {
+					auto start = _hosts.upper_bound(_last_host);
+					if (start == _hosts.end()) {
+						start = _hosts.begin();
+					}
+
+					auto i = start;
+					do {
+						Host &h = i->second;
+						if (!h.queue.empty() && (h.active < _max_per_host)) {
+							chosen = i;
+							job = h.queue.begin();
+							break;
+						}
+
+						if (++i == _hosts.end()) {
+							i = _hosts.begin();
+						}
+					} while (i != start);
+				}
+
+				if (chosen == _hosts.end()) {
+					return false;
+				}
+
+				host = chosen->first;
+				p = Take(chosen->second, job);
+				_last_host = host;
+				return true;
+			}
+
+			// jobs that waited too long by age, ahead of the rest by size
+			static bool Before(const Pending &a, const Pending &b, const util::io::Deadline &aged) noexcept {
+				bool a_aged = (a.submitted <= aged);
+				bool b_aged = (b.submitted <= aged);
+				if (a_aged != b_aged) {
+					return a_aged;
+				}
+				if (a_aged) {
+					return (a.submitted < b.submitted);
+				}
+				return (std::make_pair(a.job.size, a.id) < std::make_pair(b.job.size, b.id));
+			}
+
+			static void Push(Host &h, Pending p, bool front) {
+				auto i = h.queue.insert(front ? h.queue.begin() : h.queue.end(), std::move(p));
+				h.by_size.emplace(std::make_pair(i->job.size, i->id), i);
+				h.by_age.emplace(std::make_pair(i->submitted, i->id), i);
+			}
+
+			static Pending Take(Host &h, std::list<Pending>::iterator i) {
+				h.by_size.erase(std::make_pair(i->job.size, i->id));
+				h.by_age.erase(std::make_pair(i->submitted, i->id));
+				Pending p = std::move(*i);
+				h.queue.erase(i);
+				return p;
+			}
+
+			void Run(const Job &job, util::error::Error &err) {
+				auto lease = _pool.Acquire(job.server, job.user, job.pass, err);
+				if (err) {
+					return;
+				}
+
+				if (job.direction == Direction::GET) {
+					lease->Download(job.local_path, job.remote_path, err);
+				}
+				else {
+					lease->Upload(job.remote_path, job.local_path, err);
+				}
+
+				// the control connection may be anywhere in the middle of a reply
+				if (err && !err.Is<error::FtpError>(error::FtpErrorCode::REPLY_NEGATIVE)) {
+					lease.Discard();
+				}
+			}
+
+			void Finish(std::unique_lock<std::mutex> &ul, const std::string &host, Pending p, const util::error::Error &err) {
+				if (err && !_stopped && Retriable(err) && (p.attempts < _max_attempts)) {
+					size_t shift = (std::min)(p.attempts - 1, (size_t)20);
+					auto delay = (std::min)(_max_backoff, std::chrono::milliseconds(_backoff.count() << shift));
+					++_retries;
+					_delayed.emplace(util::io::Clock::now() + delay, std::make_pair(host, std::move(p)));
+					return;
+				}
+
+				if (err) {
+					++_failed;
+				}
+				else {
+					++_succeeded;
+				}
+				auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(util::io::Clock::now() - p.submitted);
+				Report(ul, { p.id, std::move(p.job), err, p.attempts, elapsed });
+			}
+
+			// jobs that never got to run
+			void Abort(std::unique_lock<std::mutex> &ul) {
+				std::vector<Pending> aborted;
+				for (auto &h : _hosts) {
+					for (auto &p : h.second.queue) {
+						aborted.push_back(std::move(p));
+					}
+					h.second.queue.clear();
+					h.second.by_size.clear();
+					h.second.by_age.clear();
+				}
+				for (auto &d : _delayed) {
+					aborted.push_back(std::move(d.second.second));
+				}
+				_delayed.clear();
+
+				util::error::Error err;
+				err = util::error::IOError(util::error::IOErrorCode::OPERATION_ABORTED, "transfer");
+				for (auto &p : aborted) {
+					++_failed;
+					Report(ul, { p.id, std::move(p.job), err, p.attempts, std::chrono::milliseconds::zero() });
+				}
+			}
+
+			// the callback runs without the lock; a job counts as finished once it returned
+			void Report(std::unique_lock<std::mutex> &ul, Result r) {
+				_results.push_back(r);
+
+				Callback callback = _callback;
+				if (callback) {
+					ul.unlock();
+					callback(r);
+					ul.lock();
+				}
+
+				if (--_unfinished == 0) {
+					_done_cv.notify_all();
+				}
+			}
+		};
+
+	}
+
+}
\ No newline at end of file
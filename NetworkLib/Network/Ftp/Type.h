@@ -9,7 +9,23 @@ namespace network {
 
 	namespace ftp {
 
+#ifdef _WIN32
 		namespace fs = std::experimental::filesystem;
+#else
+		namespace fs = std::filesystem;
+#endif
+
+		enum class TransferEngine {
+			STREAM = 0,
+			URING,
+			SPLICE,
+		};
+
+		// representation type of the data sent with TYPE
+		enum class DataType : char {
+			ASCII = 'A',
+			IMAGE = 'I',
+		};
 
 		struct File {
 			using Ptr = typename std::shared_ptr<File>;
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstdint>
+
+#ifdef _WIN32
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#include <linux/errqueue.h>
+#endif
+
+namespace network {
+
+	namespace native {
+
+#ifdef _WIN32
+		using Handle = SOCKET;
+		using SSize = int;
+		using IoVec = WSABUF;
+
+		const Handle INVALID = INVALID_SOCKET;
+
+		const int SHUTDOWN_RECEIVE = SD_RECEIVE;
+		const int SHUTDOWN_SEND = SD_SEND;
+		const int SHUTDOWN_BOTH = SD_BOTH;
+
+		const int SEND_FLAGS = 0;
+		// Winsock has no per-call flag, a send with a deadline can still block there
+		const int DONT_WAIT = 0;
+#else
+		using Handle = int;
+		using SSize = ssize_t;
+		using IoVec = iovec;
+
+		const Handle INVALID = -1;
+
+		const int SHUTDOWN_RECEIVE = SHUT_RD;
+		const int SHUTDOWN_SEND = SHUT_WR;
+		const int SHUTDOWN_BOTH = SHUT_RDWR;
+
+#ifdef MSG_NOSIGNAL
+		const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+		const int SEND_FLAGS = 0;
+#endif
+
+		const int DONT_WAIT = MSG_DONTWAIT;
+#endif
+
+		const int ERROR_RESULT = -1;
+
+		const size_t MAX_IOV = 64;
+
+		inline int LastError() noexcept {
+#ifdef _WIN32
+			return WSAGetLastError();
+#else
+			return errno;
+#endif
+		}
+
+		inline bool WouldBlock(int ec) noexcept {
+#ifdef _WIN32
+			return (ec == WSAEWOULDBLOCK);
+#else
+			return ((ec == EAGAIN) || (ec == EWOULDBLOCK));
+#endif
+		}
+
+		inline bool InProgress(int ec) noexcept {
+#ifdef _WIN32
+			return ((ec == WSAEWOULDBLOCK) || (ec == WSAEINPROGRESS));
+#else
+			return (ec == EINPROGRESS);
+#endif
+		}
+
+		inline int Close(Handle s) noexcept {
+#ifdef _WIN32
+			return closesocket(s);
+#else
+			return ::close(s);
+#endif
+		}
+
+		inline int Poll(pollfd *fds, size_t count, int timeout_ms) noexcept {
+#ifdef _WIN32
+			return WSAPoll(fds, static_cast<ULONG>(count), timeout_ms);
+#else
+			return ::poll(fds, static_cast<nfds_t>(count), timeout_ms);
+#endif
+		}
+
+		// pending error of a socket, e.g. the outcome of a non-blocking connect
+		inline int SocketError(Handle s) noexcept {
+			int ec = 0;
+			socklen_t size = sizeof(ec);
+			if (getsockopt(s, SOL_SOCKET, SO_ERROR, reinterpret_cast<char *>(&ec), &size) != 0) {
+				return LastError();
+			}
+			return ec;
+		}
+
+		inline int SetNonBlocking(Handle s, bool on) noexcept {
+#ifdef _WIN32
+			u_long mode = on ? 1 : 0;
+			return ioctlsocket(s, FIONBIO, &mode);
+#else
+			int flags = fcntl(s, F_GETFL, 0);
+			if (flags == ERROR_RESULT) {
+				return ERROR_RESULT;
+			}
+
+			flags = on ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+			return fcntl(s, F_SETFL, flags);
+#endif
+		}
+
+		inline SSize Send(Handle s, const void *data, size_t size, int flags) noexcept {
+#ifdef _WIN32
+			return ::send(s, static_cast<const char *>(data), static_cast<int>(size), flags | SEND_FLAGS);
+#else
+			return ::send(s, data, size, flags | SEND_FLAGS);
+#endif
+		}
+
+		inline SSize Receive(Handle s, void *data, size_t size, int flags) noexcept {
+#ifdef _WIN32
+			return ::recv(s, static_cast<char *>(data), static_cast<int>(size), flags);
+#else
+			return ::recv(s, data, size, flags);
+#endif
+		}
+
+		inline void SetIoVec(IoVec &v, const void *data, size_t size) noexcept {
+#ifdef _WIN32
+			v.buf = static_cast<char *>(const_cast<void *>(data));
+			v.len = static_cast<ULONG>(size);
+#else
+			v.iov_base = const_cast<void *>(data);
+			v.iov_len = size;
+#endif
+		}
+
+		inline SSize SendV(Handle s, IoVec *iov, size_t count, int flags) noexcept {
+#ifdef _WIN32
+			DWORD n = 0;
+			if (WSASend(s, iov, static_cast<DWORD>(count), &n, static_cast<DWORD>(flags), nullptr, nullptr) != 0) {
+				return ERROR_RESULT;
+			}
+			return static_cast<SSize>(n);
+#else
+			msghdr msg = {};
+			msg.msg_iov = iov;
+			msg.msg_iovlen = count;
+			return ::sendmsg(s, &msg, flags | SEND_FLAGS);
+#endif
+		}
+
+		inline SSize ReceiveV(Handle s, IoVec *iov, size_t count, int flags) noexcept {
+#ifdef _WIN32
+			DWORD n = 0;
+			DWORD f = static_cast<DWORD>(flags);
+			if (WSARecv(s, iov, static_cast<DWORD>(count), &n, &f, nullptr, nullptr) != 0) {
+				return ERROR_RESULT;
+			}
+			return static_cast<SSize>(n);
+#else
+			msghdr msg = {};
+			msg.msg_iov = iov;
+			msg.msg_iovlen = count;
+			return ::recvmsg(s, &msg, flags);
+#endif
+		}
+
+#if defined(__linux__)
+		inline SSize SendFile(Handle s, int fd, uint64_t &offset, size_t count) noexcept {
+			off_t off = static_cast<off_t>(offset);
+			SSize ret = ::sendfile(s, fd, &off, count);
+			offset = static_cast<uint64_t>(off);
+			return ret;
+		}
+
+		inline SSize Splice(int in, int out, size_t count) noexcept {
+			return ::splice(in, nullptr, out, nullptr, count, SPLICE_F_MOVE | SPLICE_F_MORE);
+		}
+#endif
+
+	}
+
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <functional>
 
 #include <Util/Buffer.h>
@@ -24,6 +25,12 @@ namespace network {
 				Parse();
 			}
 
+			void Input(std::string_view s) {
+				_sta = _cur = s.data();
+				_end = _cur + s.size();
+				Parse();
+			}
+
 			void Input(const char *start, const char *end) {
 				_sta  = _cur = start;
 				_end = end;
@@ -56,7 +56,11 @@ namespace network {
 
 							std::time_t curt = std::time(nullptr);
 							std::tm cur;
+#ifdef _WIN32
 							gmtime_s(&cur, &curt);
+#else
+							gmtime_r(&curt, &cur);
+#endif
 							t.tm_year = cur.tm_year;
 						}
 						else {
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <WinSock2.h>
+#include <Network/Native.h>
 
 #include <Network/Endpoint.h>
 #include <Network/Resolver/Resolver.h>
@@ -11,11 +11,11 @@ namespace network {
 	class Tcp {
 	public:
 		using Socket = StreamSocket<Tcp>;
-		using Endpoint = Endpoint<Tcp>;
+		using Endpoint = network::Endpoint<Tcp>;
 		using Resolver = resolver::Resolver<Tcp>;
 
-		const int TYPE = SOCK_STREAM;
-		const int PROTOCOL = IPPROTO_TCP;
+		static const int TYPE = SOCK_STREAM;
+		static const int PROTOCOL = IPPROTO_TCP;
 
 	public:
 		static Tcp v4() noexcept {
@@ -26,6 +26,10 @@ namespace network {
 			return Tcp(AF_INET6);
 		}
 
+		static Tcp ForFamily(int family) noexcept {
+			return Tcp(family);
+		}
+
 		int Family() const noexcept {
 			return _family;
 		}
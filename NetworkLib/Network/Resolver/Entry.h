@@ -12,18 +12,18 @@ namespace network {
 		class Entry {
 		public:
 			using Ptr = typename std::shared_ptr<Entry>;
-			using Query = typename Query<InternetProtocol>;
-			using Endpoint = typename Endpoint<InternetProtocol>;
+			using Query = resolver::Query<InternetProtocol>;
+			using Endpoint = network::Endpoint<InternetProtocol>;
 
 		public:
-			Entry(const typename Query::Ptr query, PADDRINFOA i) noexcept
+			Entry(const typename Query::Ptr query, const addrinfo *i) noexcept
 				: _query(query),
 				_family(i->ai_family),
 				_type(i->ai_socktype),
 				_protocol(i->ai_protocol),
 				_endpoint(i->ai_addr, i->ai_addrlen) {}
 
-			static Ptr New(const typename Query::Ptr query, PADDRINFOA i) noexcept {
+			static Ptr New(const typename Query::Ptr query, const addrinfo *i) noexcept {
 				auto e = std::make_shared<Entry>(query, i);
 				return e;
 			}
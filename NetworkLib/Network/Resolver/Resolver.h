@@ -4,7 +4,7 @@
 #include <string>
 #include <functional>
 
-#include <WS2tcpip.h>
+#include <Network/Native.h>
 
 #include <Network/Protocol/Tcp.h>
 #include <Network/Address/Address.h>
@@ -23,25 +23,25 @@ namespace network {
 		template<class InternetProtocol>
 		class Resolver {
 		public:
-			using Entry = typename Entry<InternetProtocol>;
-			using Query = typename Query<InternetProtocol>;
-			using Result = typename Result<InternetProtocol>;
+			using Entry = resolver::Entry<InternetProtocol>;
+			using Query = resolver::Query<InternetProtocol>;
+			using Result = resolver::Result<InternetProtocol>;
 
 		public:
 			Resolver(util::io::IOContext &ctx) noexcept
 				: _ctx(ctx) {}
 
 			typename Result::Ptr Resolve(const std::string &host, const std::string &service, util::error::Error &err) {
-				PADDRINFOA pinfo;
-				int ec = GetAddrInfoA(host.c_str(), service.c_str(), nullptr, &pinfo);
+				addrinfo *pinfo;
+				int ec = getaddrinfo(host.c_str(), service.c_str(), nullptr, &pinfo);
 				if (ec != 0) {
-					err = util::error::lib::SocketError(ec, "GetAddrInfoA");
+					err = util::error::lib::SocketError(ec, "getaddrinfo");
 					return nullptr;
 				}
 
-				Query::Ptr q = Query::New(host, service);
-				Result::Ptr r = Result::New(q, pinfo);
-				FreeAddrInfoA(pinfo);
+				typename Query::Ptr q = Query::New(host, service);
+				typename Result::Ptr r = Result::New(q, pinfo);
+				freeaddrinfo(pinfo);
 
 				return r;
 			}
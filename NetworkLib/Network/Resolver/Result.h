@@ -14,8 +14,8 @@ namespace network {
 		class Result : public std::vector<typename Entry<InternetProtocol>::Ptr> {
 		public:
 			using Ptr = typename std::shared_ptr<Result>;
-			using Entry = typename Entry<InternetProtocol>;
-			using Query = typename Query<InternetProtocol>;
+			using Entry = resolver::Entry<InternetProtocol>;
+			using Query = resolver::Query<InternetProtocol>;
 
 			friend Ptr;
 
@@ -23,10 +23,10 @@ namespace network {
 			Result(typename Query::Ptr query) noexcept
 				: _query(query) {}
 
-			static Ptr New(typename Query::Ptr query, PADDRINFOA i) {
+			static Ptr New(typename Query::Ptr query, const addrinfo *i) {
 				auto r = std::make_shared<Result>(query);
 
-				Entry::Ptr e;
+				typename Entry::Ptr e;
 				for (; i; i = i->ai_next) {
 					e = Entry::New(query, i);
 					r->push_back(e);
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include <Network/Error.h>
+#include <Network/Native.h>
+#include <Network/Resolver/Entry.h>
+#include <Network/Resolver/Result.h>
+
+#include <Util/Error.h>
+
+namespace network {
+
+	// Happy Eyeballs (RFC 8305): races staggered connection attempts across all resolved
+	// addresses, alternating families, and keeps the first one that succeeds
+	template<class InternetProtocol>
+	class Connector {
+	public:
+		using Entry = resolver::Entry<InternetProtocol>;
+		using Result = resolver::Result<InternetProtocol>;
+
+		// called on every attempt socket before connect, e.g. to apply socket options
+		using Prepare = std::function<void(native::Handle, util::error::Error &)>;
+
+		static constexpr std::chrono::milliseconds ATTEMPT_DELAY = std::chrono::milliseconds(250);
+
+	public:
+		explicit Connector(const InternetProtocol &protocol, std::chrono::milliseconds attempt_delay = ATTEMPT_DELAY) noexcept
+			: _protocol(protocol),
+			_attempt_delay(attempt_delay) {}
+
+		// a zero timeout waits for the attempts to fail on their own
+		native::Handle Connect(const typename Result::Ptr &endpoints, std::chrono::milliseconds timeout, const Prepare &prepare,
+			typename Entry::Ptr &winner, util::error::Error &err) {
+			using Clock = std::chrono::steady_clock;
+
+			std::vector<typename Entry::Ptr> entries = Order(endpoints);
+			std::vector<pollfd> attempts;
+			std::vector<typename Entry::Ptr> attempt_entries;
+
+			util::error::Error last_err = network::error::NetworkError(network::error::NetworkErrorCode::NO_ENDPOINT).Error();
+			native::Handle s = native::INVALID;
+
+			Clock::time_point now = Clock::now();
+			Clock::time_point deadline = now + timeout;
+			Clock::time_point next_attempt = now;
+			size_t next = 0;
+
+			while (s == native::INVALID) {
+				now = Clock::now();
+				if ((timeout.count() > 0) && (now >= deadline)) {
+					last_err = util::error::IOError(util::error::IOErrorCode::TIMED_OUT, "connect").Error();
+					break;
+				}
+
+				if ((next < entries.size()) && (attempts.empty() || (now >= next_attempt))) {
+					const typename Entry::Ptr &e = entries[next++];
+					next_attempt = now + _attempt_delay;
+
+					native::Handle a = Start(e, prepare, last_err);
+					if (a == native::INVALID) {
+						next_attempt = now;
+						continue;
+					}
+
+					attempts.push_back({ a, POLLOUT, 0 });
+					attempt_entries.push_back(e);
+					continue;
+				}
+
+				if (attempts.empty()) {
+					break;
+				}
+
+				int wait = -1;
+				if (next < entries.size()) {
+					wait = Milliseconds(next_attempt - now);
+				}
+				if (timeout.count() > 0) {
+					int left = Milliseconds(deadline - now);
+					wait = (wait < 0) ? left : (std::min)(wait, left);
+				}
+
+				int n = native::Poll(attempts.data(), attempts.size(), wait);
+				if (n == native::ERROR_RESULT) {
+					int ec = native::LastError();
+					if (ec == EINTR) {
+						continue;
+					}
+					last_err = util::error::lib::SocketError(ec, "poll");
+					break;
+				}
+
+				for (size_t i = 0; i < attempts.size();) {
+					if (attempts[i].revents == 0) {
+						++i;
+						continue;
+					}
+
+					int ec = native::SocketError(attempts[i].fd);
+					if (ec == 0) {
+						s = attempts[i].fd;
+						winner = attempt_entries[i];
+						attempts.erase(attempts.begin() + i);
+						attempt_entries.erase(attempt_entries.begin() + i);
+						break;
+					}
+
+					// a failed attempt lets the next one start right away
+					native::Close(attempts[i].fd);
+					last_err = util::error::lib::SocketError(ec, "connect");
+					attempts.erase(attempts.begin() + i);
+					attempt_entries.erase(attempt_entries.begin() + i);
+					next_attempt = now;
+				}
+			}
+
+			for (auto &a : attempts) {
+				native::Close(a.fd);
+			}
+
+			if (s == native::INVALID) {
+				err = last_err;
+				return native::INVALID;
+			}
+
+			if (native::SetNonBlocking(s, false) != 0) {
+				err = util::error::lib::SocketError(native::LastError());
+				native::Close(s);
+				return native::INVALID;
+			}
+
+			return s;
+		}
+
+	private:
+		InternetProtocol _protocol;
+		std::chrono::milliseconds _attempt_delay;
+
+	private:
+		static int Milliseconds(std::chrono::steady_clock::duration d) noexcept {
+			auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+			return (ms > 0) ? (int)ms + 1 : 0;
+		}
+
+		// keeps the resolver's preference within a family and alternates families, starting with the first one
+		std::vector<typename Entry::Ptr> Order(const typename Result::Ptr &endpoints) const {
+			std::vector<typename Entry::Ptr> first;
+			std::vector<typename Entry::Ptr> second;
+			if (!endpoints) {
+				return first;
+			}
+
+			int family = 0;
+			for (auto &i : (*endpoints)) {
+				if (!i->Is(i->Family(), _protocol.Type(), _protocol.Protocol())) {
+					continue;
+				}
+				if (family == 0) {
+					family = i->Family();
+				}
+				((i->Family() == family) ? first : second).push_back(i);
+			}
+
+			std::vector<typename Entry::Ptr> entries;
+			entries.reserve(first.size() + second.size());
+			for (size_t i = 0; (i < first.size()) || (i < second.size()); i++) {
+				if (i < first.size()) {
+					entries.push_back(first[i]);
+				}
+				if (i < second.size()) {
+					entries.push_back(second[i]);
+				}
+			}
+			return entries;
+		}
+
+		// returns a socket with a connect in progress or already established
+		native::Handle Start(const typename Entry::Ptr &e, const Prepare &prepare, util::error::Error &err) {
+			native::Handle a = socket(e->Family(), _protocol.Type(), _protocol.Protocol());
+			if (a == native::INVALID) {
+				err = util::error::lib::SocketError(native::LastError(), "socket");
+				return native::INVALID;
+			}
+
+			util::error::Error perr;
+			if (prepare) {
+				prepare(a, perr);
+			}
+			if (!perr && (native::SetNonBlocking(a, true) != 0)) {
+				perr = util::error::lib::SocketError(native::LastError());
+			}
+			if (perr) {
+				native::Close(a);
+				err = perr;
+				return native::INVALID;
+			}
+
+			const auto &pe = e->GetEndpoint();
+			int ret = connect(a, pe.Data(), pe.Size());
+			if (ret != 0) {
+				int ec = native::LastError();
+				if (!native::InProgress(ec)) {
+					native::Close(a);
+					err = util::error::lib::SocketError(ec, "connect");
+					return native::INVALID;
+				}
+			}
+
+			return a;
+		}
+	};
+
+}
\ No newline at end of file
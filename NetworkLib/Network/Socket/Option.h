@@ -0,0 +1,184 @@
+#pragma once
+
+#include <optional>
+
+#include <Network/Error.h>
+#include <Network/Native.h>
+
+#include <Util/Error.h>
+
+namespace network {
+
+	namespace option {
+
+		template<int OptionLevel, int OptionName>
+		class Boolean {
+		public:
+			explicit Boolean(bool value = false) noexcept
+				: _value(value ? 1 : 0) {}
+
+			int Level() const noexcept {
+				return OptionLevel;
+			}
+
+			int Name() const noexcept {
+				return OptionName;
+			}
+
+			bool Value() const noexcept {
+				return (_value != 0);
+			}
+
+			void *Data() noexcept {
+				return &_value;
+			}
+
+			const void *Data() const noexcept {
+				return &_value;
+			}
+
+			size_t Size() const noexcept {
+				return sizeof(_value);
+			}
+
+		private:
+			int _value;
+		};
+
+		template<int OptionLevel, int OptionName>
+		class Integer {
+		public:
+			explicit Integer(int value = 0) noexcept
+				: _value(value) {}
+
+			int Level() const noexcept {
+				return OptionLevel;
+			}
+
+			int Name() const noexcept {
+				return OptionName;
+			}
+
+			int Value() const noexcept {
+				return _value;
+			}
+
+			void *Data() noexcept {
+				return &_value;
+			}
+
+			const void *Data() const noexcept {
+				return &_value;
+			}
+
+			size_t Size() const noexcept {
+				return sizeof(_value);
+			}
+
+		private:
+			int _value;
+		};
+
+		using NoDelay = Boolean<IPPROTO_TCP, TCP_NODELAY>;
+		using KeepAlive = Boolean<SOL_SOCKET, SO_KEEPALIVE>;
+		using ReuseAddress = Boolean<SOL_SOCKET, SO_REUSEADDR>;
+		using SendBufferSize = Integer<SOL_SOCKET, SO_SNDBUF>;
+		using ReceiveBufferSize = Integer<SOL_SOCKET, SO_RCVBUF>;
+
+#ifdef TCP_QUICKACK
+		// not sticky, the kernel may clear it again after the next read
+		using QuickAck = Boolean<IPPROTO_TCP, TCP_QUICKACK>;
+#endif
+
+#ifdef TCP_NOTSENT_LOWAT
+		using NotSentLowWatermark = Integer<IPPROTO_TCP, TCP_NOTSENT_LOWAT>;
+#endif
+
+		// Options left empty are not touched when a profile is applied
+		struct Profile {
+			std::optional<bool> no_delay;
+			std::optional<bool> keep_alive;
+			std::optional<int> send_buffer_size;
+			std::optional<int> receive_buffer_size;
+			std::optional<int> not_sent_low_watermark;
+
+			static Profile Default() noexcept {
+				return Profile();
+			}
+
+			// small command/reply exchanges: no Nagle
+			static Profile LowLatency() noexcept {
+				Profile p;
+				p.no_delay = true;
+				p.keep_alive = true;
+				return p;
+			}
+
+			// Buffers are left to the kernel's autotuning unless a size is given: a fixed size
+			// turns autotuning off for the socket and is clamped to wmem_max/rmem_max. A size
+			// has to be applied before connecting for the receive window to scale.
+			static Profile BulkThroughput(int buffer_size = 0) noexcept {
+				Profile p;
+				if (buffer_size > 0) {
+					p.send_buffer_size = buffer_size;
+					p.receive_buffer_size = buffer_size;
+				}
+				return p;
+			}
+
+			// options set in p override the ones set here
+			void Merge(const Profile &p) noexcept {
+				if (p.no_delay) {
+					no_delay = p.no_delay;
+				}
+				if (p.keep_alive) {
+					keep_alive = p.keep_alive;
+				}
+				if (p.send_buffer_size) {
+					send_buffer_size = p.send_buffer_size;
+				}
+				if (p.receive_buffer_size) {
+					receive_buffer_size = p.receive_buffer_size;
+				}
+				if (p.not_sent_low_watermark) {
+					not_sent_low_watermark = p.not_sent_low_watermark;
+				}
+			}
+		};
+
+		template<class Option>
+		inline void Set(native::Handle s, const Option &o, util::error::Error &err) {
+			int ret = setsockopt(s, o.Level(), o.Name(), static_cast<const char *>(o.Data()), static_cast<socklen_t>(o.Size()));
+			GetSocketError(err, ret);
+		}
+
+		template<class Option>
+		inline void Get(native::Handle s, Option &o, util::error::Error &err) {
+			socklen_t size = static_cast<socklen_t>(o.Size());
+			int ret = getsockopt(s, o.Level(), o.Name(), static_cast<char *>(o.Data()), &size);
+			GetSocketError(err, ret);
+		}
+
+		inline void Apply(native::Handle s, const Profile &p, util::error::Error &err) {
+			if (p.no_delay) {
+				Set(s, NoDelay(*p.no_delay), err);
+			}
+			if (!err && p.keep_alive) {
+				Set(s, KeepAlive(*p.keep_alive), err);
+			}
+			if (!err && p.send_buffer_size) {
+				Set(s, SendBufferSize(*p.send_buffer_size), err);
+			}
+			if (!err && p.receive_buffer_size) {
+				Set(s, ReceiveBufferSize(*p.receive_buffer_size), err);
+			}
+#ifdef TCP_NOTSENT_LOWAT
+			if (!err && p.not_sent_low_watermark) {
+				Set(s, NotSentLowWatermark(*p.not_sent_low_watermark), err);
+			}
+#endif
+		}
+
+	}
+
+}
\ No newline at end of file
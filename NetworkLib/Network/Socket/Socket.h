@@ -1,17 +1,22 @@
 #pragma once
 
+#include <mutex>
+#include <chrono>
 #include <thread>
+#include <algorithm>
 #include <functional>
 
-#include <WinSock2.h>
-
 #include <Network/Error.h>
+#include <Network/Native.h>
 #include <Network/Endpoint.h>
+#include <Network/Socket/Option.h>
+#include <Network/Socket/Connector.h>
 #include <Network/Resolver/Resolver.h>
 
 #include <Util/IO.h>
 #include <Util/Error.h>
 #include <Util/Buffer.h>
+#include <Util/Timer.h>
 #include <Util/Thread.h>
 
 namespace network {
@@ -19,8 +24,9 @@ namespace network {
 	template<class InternetProtocol>
 	class Socket {
 	public:
-		using Resolver = typename resolver::Resolver<InternetProtocol>;
-		using Endpoint = typename Endpoint<InternetProtocol>;
+		using Resolver = resolver::Resolver<InternetProtocol>;
+		using Endpoint = network::Endpoint<InternetProtocol>;
+		using Connector = network::Connector<InternetProtocol>;
 
 		using Ptr = typename std::shared_ptr<Socket>;
 
@@ -34,7 +40,7 @@ namespace network {
 		virtual ~Socket() {
 			// ignore all errors
 			util::error::Error err;
-			Shutdown(SD_BOTH, err);
+			Shutdown(native::SHUTDOWN_BOTH, err);
 			Close(err);
 		}
 
@@ -43,10 +49,41 @@ namespace network {
 				return;
 			}
 
-			int ret = closesocket(_s);
+#if defined(__linux__)
+			{
+				std::lock_guard<std::mutex> lg(_descriptor_mutex);
+				if (_descriptor) {
+					_ctx.GetReactor().Deregister(_descriptor);
+					_descriptor = nullptr;
+				}
+			}
+#endif
+
+			int ret = native::Close(_s);
 			GetSocketError(err, ret);
 
-			_s = -1;
+			_s = native::INVALID;
+		}
+
+		// replaces the socket by a new one of the given protocol, keeping the applied options
+		void Open(const InternetProtocol &protocol, util::error::Error &err) {
+			Close(err);
+			if (err) {
+				return;
+			}
+
+			_protocol = protocol;
+			_s = socket(_protocol.Family(), _protocol.Type(), _protocol.Protocol());
+			if (!IsOpen()) {
+				err = util::error::lib::SocketError(native::LastError(), "socket");
+				return;
+			}
+
+			option::Apply(_s, _profile, err);
+		}
+
+		const InternetProtocol &Protocol() const noexcept {
+			return _protocol;
 		}
 
 		void Shutdown(int how, util::error::Error &err) {
@@ -59,7 +96,7 @@ namespace network {
 		}
 
 		bool IsOpen() const noexcept {
-			return (_s != -1);
+			return (_s != native::INVALID);
 		}
 
 		bool IsOpen(util::error::Error &err) const {
@@ -71,18 +108,74 @@ namespace network {
 			return false;
 		}
 
+		void SetNonBlocking(bool on, util::error::Error &err) {
+			if (!IsOpen(err)) {
+				return;
+			}
+
+			int ret = native::SetNonBlocking(_s, on);
+			GetSocketError(err, ret);
+		}
+
+		template<class Option>
+		void SetOption(const Option &o, util::error::Error &err) {
+			if (!IsOpen(err)) {
+				return;
+			}
+
+			option::Set(_s, o, err);
+		}
+
+		template<class Option>
+		void GetOption(Option &o, util::error::Error &err) const {
+			if (!IsOpen(err)) {
+				return;
+			}
+
+			option::Get(_s, o, err);
+		}
+
+		// the profile is remembered and applied again to the sockets Connect opens for resolved endpoints
+		void Apply(const option::Profile &p, util::error::Error &err) {
+			if (!IsOpen(err)) {
+				return;
+			}
+
+			_profile.Merge(p);
+			option::Apply(_s, p, err);
+		}
+
 		void Connect(const typename Resolver::Result::Ptr &endpoints, util::error::Error &err) {
-			for (auto &i : (*endpoints)) {
-				if (i->Is(_protocol)) {
-					Connect(i->GetEndpoint(), err);
-					return;
-				}
+			Connect(endpoints, std::chrono::milliseconds::zero(), err);
+		}
+
+		// races the resolved endpoints and keeps the first connection established, see Connector
+		void Connect(const typename Resolver::Result::Ptr &endpoints, std::chrono::milliseconds timeout, util::error::Error &err) {
+			option::Profile profile = _profile;
+			auto prepare = [&profile](native::Handle s, util::error::Error &err) {
+				option::Apply(s, profile, err);
+			};
+
+			typename Connector::Entry::Ptr winner;
+			Connector connector(_protocol);
+			native::Handle s = connector.Connect(endpoints, timeout, prepare, winner, err);
+			if (err) {
+				return;
+			}
+
+			Close(err);
+			if (err) {
+				native::Close(s);
+				return;
 			}
+
+			_s = s;
+			_protocol = InternetProtocol::ForFamily(winner->Family());
 		}
 
 		void Connect(const std::string &host, const std::string &port, util::error::Error &err) {
-			Tcp::Resolver resolver(_ctx);
-			Tcp::Resolver::Result::Ptr endpoints = resolver.Resolve(host, port, err);
+			Resolver resolver(_ctx);
+			typename Resolver::Result::Ptr endpoints = resolver.Resolve(host, port, err);
 			if (err) {
 				return;
 			}
@@ -93,11 +186,21 @@ namespace network {
 			}
 		}
 
+		void Connect(const std::string &host, const std::string &port, std::chrono::milliseconds timeout, util::error::Error &err) {
+			Resolver resolver(_ctx);
+			typename Resolver::Result::Ptr endpoints = resolver.Resolve(host, port, err);
+			if (err) {
+				return;
+			}
+
+			Connect(endpoints, timeout, err);
+		}
+
 		void Connect(const Endpoint &pe, util::error::Error &err) {
 			if (!IsOpen(err)) {
 				return;
 			}
-			
+
 			int ret = connect(_s, pe.Data(), pe.Size());
 			GetSocketError(err, ret);
 			if (err) {
@@ -105,14 +208,90 @@ namespace network {
 			}
 		}
 
+		// waits until the socket can be read without blocking, fails with TIMED_OUT at the deadline
+		void WaitReadable(const util::io::Deadline &deadline, util::error::Error &err) {
+			Wait(POLLIN, deadline, err);
+		}
+
+		void WaitWritable(const util::io::Deadline &deadline, util::error::Error &err) {
+			Wait(POLLOUT, deadline, err);
+		}
+
 		util::io::IOContext &IOContext() const noexcept {
 			return _ctx;
 		}
 
+		native::Handle NativeHandle() const noexcept {
+			return _s;
+		}
+
 	protected:
-		SOCKET _s;
+		native::Handle _s;
 		util::io::IOContext &_ctx;
 		InternetProtocol _protocol;
+		option::Profile _profile;
+
+#if defined(__linux__)
+		util::io::Reactor::Descriptor::Ptr _descriptor;
+		// a read and a write started at once must not both register the socket
+		std::mutex _descriptor_mutex;
+
+	protected:
+		void StartOp(util::io::Reactor::OpType t, const util::io::Reactor::Operation::Ptr &op,
+			const util::io::Deadline &deadline = util::io::NO_DEADLINE) {
+			auto &reactor = _ctx.GetReactor();
+			util::error::Error err;
+			util::io::Reactor::Descriptor::Ptr descriptor;
+			{
+				std::lock_guard<std::mutex> lg(_descriptor_mutex);
+				if (!_descriptor) {
+					SetNonBlocking(true, err);
+					if (!err) {
+						_descriptor = reactor.Register(_s, err);
+					}
+				}
+				descriptor = _descriptor;
+			}
+
+			if (err) {
+				op->Abort(err);
+				reactor.Post([op] {
+					op->Complete();
+				});
+				return;
+			}
+
+			reactor.StartOp(descriptor, t, op, deadline);
+		}
+#endif
+
+	private:
+		void Wait(short events, const util::io::Deadline &deadline, util::error::Error &err) {
+			if (!IsOpen(err) || (deadline == util::io::NO_DEADLINE)) {
+				return;
+			}
+
+			for (;;) {
+				auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - util::io::Clock::now()).count();
+				if (left < 0) {
+					left = 0;
+				}
+
+				pollfd pfd = { _s, events, 0 };
+				int n = native::Poll(&pfd, 1, (int)(std::min<long long>)(left + 1, INT32_MAX));
+				if (n > 0) {
+					return;
+				}
+				if ((n == native::ERROR_RESULT) && (native::LastError() != EINTR)) {
+					GetSocketError(err, n);
+					return;
+				}
+				if (util::io::Expired(deadline)) {
+					err = util::error::IOError(util::error::IOErrorCode::TIMED_OUT).Error();
+					return;
+				}
+			}
+		}
 	};
 
 }
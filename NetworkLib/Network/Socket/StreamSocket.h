@@ -1,13 +1,18 @@
 #pragma once
 
-#include <WinSock2.h>
+#include <deque>
+#include <memory>
 
 #include <Network/Error.h>
+#include <Network/Native.h>
 #include <Network/Socket/Socket.h>
 
 #include <Util/IO.h>
 #include <Util/Error.h>
+#include <Util/Timer.h>
+#include <Util/Coroutine.h>
 #include <Util/Buffer.h>
+#include <Util/IOBuf.h>
 
 namespace network {
 
@@ -15,6 +20,10 @@ namespace network {
 	class StreamSocket : public Socket<InternetProtocol> {
 	public:
 		using Ptr = typename std::shared_ptr<StreamSocket>;
+		using Handler = std::function<void(const util::error::Error &, size_t)>;
+		using Endpoint = typename Socket<InternetProtocol>::Endpoint;
+
+		using Socket<InternetProtocol>::Close;
 
 	public:
 		StreamSocket(util::io::IOContext &ctx, const InternetProtocol &protocol)
@@ -23,19 +32,23 @@ namespace network {
 		virtual ~StreamSocket() {}
 
 		size_t Send(const util::buffer::ConstBuffer &b, util::error::Error &err) {
-			int ret = send(_s, static_cast<const char *>(b.Data()), b.Size(), 0);
-			
+			return Send(b, 0, err);
+		}
+
+		size_t Send(const util::buffer::ConstBuffer &b, int flags, util::error::Error &err) {
+			native::SSize ret = native::Send(this->_s, b.Data(), b.Size(), flags);
+
 			GetSocketError(err, ret);
 			if (err) {
 				Close(err);
 				return 0;
 			}
 
-			return (size_t)ret;
+			return (ret > 0) ? (size_t)ret : 0;
 		}
 
 		size_t Receive(const util::buffer::MutableBuffer &b, util::error::Error &err) {
-			int ret = recv(_s, static_cast<char *>(b.Data()), b.Size(), 0);
+			native::SSize ret = native::Receive(this->_s, b.Data(), b.Size(), 0);
 			if (ret == 0) {
 				Close(err);
 				return 0;
@@ -47,7 +60,7 @@ namespace network {
 				return 0;
 			}
 
-			return (size_t)ret;
+			return (ret > 0) ? (size_t)ret : 0;
 		}
 
 		size_t ReadSome(const util::buffer::MutableBuffer &b, util::error::Error &err) {
@@ -57,6 +70,488 @@ namespace network {
 		size_t WriteSome(const util::buffer::ConstBuffer &b, util::error::Error &err) {
 			return Send(b, err);
 		}
+
+		template<class ConstBufferSequence>
+		std::enable_if_t<util::buffer::IsConstBufferSequence<ConstBufferSequence>::value, size_t>
+			Send(const ConstBufferSequence &bs, util::error::Error &err) {
+			return Send(bs, 0, err);
+		}
+
+		template<class ConstBufferSequence>
+		std::enable_if_t<util::buffer::IsConstBufferSequence<ConstBufferSequence>::value, size_t>
+			Send(const ConstBufferSequence &bs, int flags, util::error::Error &err) {
+			native::IoVec iov[native::MAX_IOV];
+			size_t count = 0;
+			for (auto i = std::begin(bs); (i != std::end(bs)) && (count < native::MAX_IOV); ++i) {
+				util::buffer::ConstBuffer b(*i);
+				native::SetIoVec(iov[count++], b.Data(), b.Size());
+			}
+
+			native::SSize ret = native::SendV(this->_s, iov, count, flags);
+
+			GetSocketError(err, ret);
+			if (err) {
+				Close(err);
+				return 0;
+			}
+
+			return (ret > 0) ? (size_t)ret : 0;
+		}
+
+		template<class MutableBufferSequence>
+		std::enable_if_t<util::buffer::IsMutableBufferSequence<MutableBufferSequence>::value, size_t>
+			Receive(const MutableBufferSequence &bs, util::error::Error &err) {
+			native::IoVec iov[native::MAX_IOV];
+			size_t count = 0;
+			size_t size = 0;
+			for (auto i = std::begin(bs); (i != std::end(bs)) && (count < native::MAX_IOV); ++i) {
+				util::buffer::MutableBuffer b(*i);
+				native::SetIoVec(iov[count++], b.Data(), b.Size());
+				size += b.Size();
+			}
+
+			if (size == 0) {
+				return 0;
+			}
+
+			native::SSize ret = native::ReceiveV(this->_s, iov, count, 0);
+			if (ret == 0) {
+				Close(err);
+				return 0;
+			}
+
+			GetSocketError(err, ret);
+			if (err) {
+				Close(err);
+				return 0;
+			}
+
+			return (ret > 0) ? (size_t)ret : 0;
+		}
+
+		template<class MutableBufferSequence>
+		std::enable_if_t<util::buffer::IsMutableBufferSequence<MutableBufferSequence>::value, size_t>
+			ReadSome(const MutableBufferSequence &bs, util::error::Error &err) {
+			return Receive(bs, err);
+		}
+
+		template<class ConstBufferSequence>
+		std::enable_if_t<util::buffer::IsConstBufferSequence<ConstBufferSequence>::value, size_t>
+			WriteSome(const ConstBufferSequence &bs, util::error::Error &err) {
+			return Send(bs, err);
+		}
+
+		// a read that blocks past the deadline fails with TIMED_OUT
+		template<class MutableBuffers>
+		size_t ReadSome(const MutableBuffers &bs, const util::io::Deadline &deadline, util::error::Error &err) {
+			for (;;) {
+				this->WaitReadable(deadline, err);
+				if (err) {
+					return 0;
+				}
+
+				size_t nread = Receive(bs, err);
+				if ((nread > 0) || err || !this->IsOpen() || (deadline == util::io::NO_DEADLINE)) {
+					return nread;
+				}
+			}
+		}
+
+		// a write past the deadline fails with TIMED_OUT; with a deadline only what fits in the
+		// send buffer is taken, so that the send itself cannot block
+		template<class ConstBuffers>
+		size_t WriteSome(const ConstBuffers &bs, const util::io::Deadline &deadline, util::error::Error &err) {
+			int flags = (deadline == util::io::NO_DEADLINE) ? 0 : native::DONT_WAIT;
+			for (;;) {
+				this->WaitWritable(deadline, err);
+				if (err) {
+					return 0;
+				}
+
+				size_t nwrite = Send(bs, flags, err);
+				if ((nwrite > 0) || err || !this->IsOpen() || (deadline == util::io::NO_DEADLINE)) {
+					return nwrite;
+				}
+			}
+		}
+
+		// appends up to n bytes to b, into the tail of its last segment when there is room
+		size_t ReadSome(util::buffer::IOBuf &b, size_t n, util::error::Error &err) {
+			return ReadSome(b, n, util::io::NO_DEADLINE, err);
+		}
+
+		size_t ReadSome(util::buffer::IOBuf &b, size_t n, const util::io::Deadline &deadline, util::error::Error &err) {
+			size_t room = b.Tailroom();
+			auto m = b.Prepare((room > 0) ? (std::min)(n, room) : n, err);
+			if (err) {
+				return 0;
+			}
+
+			size_t nread = ReadSome(m, deadline, err);
+			b.Commit(nread);
+			return nread;
+		}
+
+		size_t WriteSome(const util::buffer::IOBuf &b, util::error::Error &err) {
+			return WriteSome(b.Buffers(), err);
+		}
+
+		size_t WriteSome(const util::buffer::IOBuf &b, const util::io::Deadline &deadline, util::error::Error &err) {
+			return WriteSome(b.Buffers(), deadline, err);
+		}
+
+#if defined(__linux__)
+		size_t SendFile(int fd, uint64_t &offset, size_t count, util::error::Error &err) {
+			native::SSize ret = native::SendFile(this->_s, fd, offset, count);
+
+			GetSocketError(err, ret);
+			if (err) {
+				Close(err);
+				return 0;
+			}
+
+			return (ret > 0) ? (size_t)ret : 0;
+		}
+
+		// sendfile has no per-call flag, the socket has to be non-blocking for the deadline to
+		// bound the send as well as the wait
+		size_t SendFile(int fd, uint64_t &offset, size_t count, const util::io::Deadline &deadline, util::error::Error &err) {
+			for (;;) {
+				this->WaitWritable(deadline, err);
+				if (err) {
+					return 0;
+				}
+
+				native::SSize ret = native::SendFile(this->_s, fd, offset, count);
+				if ((ret < 0) && native::WouldBlock(native::LastError()) && (deadline != util::io::NO_DEADLINE)) {
+					continue;
+				}
+
+				GetSocketError(err, ret);
+				if (err) {
+					Close(err);
+					return 0;
+				}
+
+				return (ret > 0) ? (size_t)ret : 0;
+			}
+		}
+
+		size_t Splice(int pipe, size_t count, util::error::Error &err) {
+			native::SSize ret = native::Splice(this->_s, pipe, count);
+			if (ret == 0) {
+				Close(err);
+				return 0;
+			}
+
+			GetSocketError(err, ret);
+			if (err) {
+				Close(err);
+				return 0;
+			}
+
+			return (ret > 0) ? (size_t)ret : 0;
+		}
+
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+		bool EnableZeroCopy(util::error::Error &err) {
+			if (!this->IsOpen(err)) {
+				return false;
+			}
+
+			int on = 1;
+			if (setsockopt(this->_s, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) != 0) {
+				return false;
+			}
+
+			_zc_enabled = true;
+			return true;
+		}
+
+		// the owner is held until the kernel reports that it no longer references the pages of b
+		size_t SendZeroCopy(const util::buffer::ConstBuffer &b, const std::shared_ptr<const void> &owner, util::error::Error &err) {
+			return SendZeroCopy(b, owner, util::io::NO_DEADLINE, err);
+		}
+
+		// waiting for completions to free optmem fails with TIMED_OUT past the deadline
+		size_t SendZeroCopy(const util::buffer::ConstBuffer &b, const std::shared_ptr<const void> &owner,
+			const util::io::Deadline &deadline, util::error::Error &err) {
+			int flags = MSG_ZEROCOPY | ((deadline == util::io::NO_DEADLINE) ? 0 : native::DONT_WAIT);
+			for (;;) {
+				native::SSize ret = native::Send(this->_s, b.Data(), b.Size(), flags);
+				if (ret > 0) {
+					_zc_pending.emplace_back(_zc_next++, owner);
+					return (size_t)ret;
+				}
+
+				if ((ret < 0) && (errno == ENOBUFS) && !_zc_pending.empty()) {
+					ReapZeroCopy(true, deadline, err);
+					if (err) {
+						return 0;
+					}
+					continue;
+				}
+
+				GetSocketError(err, ret);
+				if (err) {
+					Close(err);
+				}
+				return 0;
+			}
+		}
+
+		size_t ReapZeroCopy(bool wait, util::error::Error &err) {
+			return ReapZeroCopy(wait, util::io::NO_DEADLINE, err);
+		}
+
+		// a wait that gets no completion by the deadline fails with TIMED_OUT
+		size_t ReapZeroCopy(bool wait, const util::io::Deadline &deadline, util::error::Error &err) {
+			size_t count = 0;
+			while (!_zc_pending.empty()) {
+				char control[128];
+				msghdr msg = {};
+				msg.msg_control = control;
+				msg.msg_controllen = sizeof(control);
+
+				native::SSize ret = recvmsg(this->_s, &msg, MSG_ERRQUEUE);
+				if (ret < 0) {
+					if ((errno == EAGAIN) && wait && (count == 0)) {
+						if (util::io::Expired(deadline)) {
+							err = util::error::IOError(util::error::IOErrorCode::TIMED_OUT).Error();
+							break;
+						}
+
+						// completions are reported as POLLERR, which poll always watches for
+						int timeout = -1;
+						if (deadline != util::io::NO_DEADLINE) {
+							auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - util::io::Clock::now()).count();
+							timeout = (int)(std::min<long long>)((std::max<long long>)(left, 0) + 1, INT32_MAX);
+						}
+						pollfd pfd = { this->_s, 0, 0 };
+						poll(&pfd, 1, timeout);
+						continue;
+					}
+					if (errno != EAGAIN) {
+						err = util::error::lib::SocketError(errno, "MSG_ERRQUEUE");
+					}
+					break;
+				}
+
+				for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+					bool recverr = ((cm->cmsg_level == SOL_IP) && (cm->cmsg_type == IP_RECVERR))
+						|| ((cm->cmsg_level == SOL_IPV6) && (cm->cmsg_type == IPV6_RECVERR));
+					if (!recverr) {
+						continue;
+					}
+
+					auto serr = reinterpret_cast<const sock_extended_err *>(CMSG_DATA(cm));
+					if ((serr->ee_errno != 0) || (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)) {
+						continue;
+					}
+
+					if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+						++_zc_copied;
+					}
+
+					while (!_zc_pending.empty() && ((int32_t)(_zc_pending.front().first - serr->ee_data) <= 0)) {
+						_zc_pending.pop_front();
+						++count;
+					}
+				}
+			}
+			return count;
+		}
+
+		bool ZeroCopyEnabled() const noexcept {
+			return _zc_enabled;
+		}
+
+		size_t ZeroCopyPending() const noexcept {
+			return _zc_pending.size();
+		}
+
+		// number of completions for which the kernel fell back to copying, e.g. over loopback
+		size_t ZeroCopyCopied() const noexcept {
+			return _zc_copied;
+		}
+#endif
+
+		void AsyncReadSome(const util::buffer::MutableBuffer &b, Handler handler) {
+			AsyncReadSome(b, util::io::NO_DEADLINE, std::move(handler));
+		}
+
+		void AsyncWriteSome(const util::buffer::ConstBuffer &b, Handler handler) {
+			AsyncWriteSome(b, util::io::NO_DEADLINE, std::move(handler));
+		}
+
+		// the handler gets TIMED_OUT if no data arrived by the deadline
+		void AsyncReadSome(const util::buffer::MutableBuffer &b, const util::io::Deadline &deadline, Handler handler) {
+			auto op = std::make_shared<ReceiveOperation>(this->_s, b, std::move(handler));
+			this->StartOp(util::io::Reactor::OpType::READ, op, deadline);
+		}
+
+		void AsyncWriteSome(const util::buffer::ConstBuffer &b, const util::io::Deadline &deadline, Handler handler) {
+			auto op = std::make_shared<SendOperation>(this->_s, b, std::move(handler));
+			this->StartOp(util::io::Reactor::OpType::WRITE, op, deadline);
+		}
+
+		// the socket has to be of the endpoint's family, see Open
+		void AsyncConnect(const Endpoint &pe, const util::io::Deadline &deadline, Handler handler) {
+			auto op = std::make_shared<ConnectOperation>(this->_s, pe, std::move(handler));
+			this->StartOp(util::io::Reactor::OpType::WRITE, op, deadline);
+		}
+
+#ifdef UTIL_COROUTINE
+		// size_t n = co_await s.AsyncReadSome(b, err);
+		auto AsyncReadSome(const util::buffer::MutableBuffer &b, util::error::Error &err) {
+			return AsyncReadSome(b, util::io::NO_DEADLINE, err);
+		}
+
+		auto AsyncReadSome(const util::buffer::MutableBuffer &b, const util::io::Deadline &deadline, util::error::Error &err) {
+			return util::io::Await([this, b, deadline](Handler handler) {
+				AsyncReadSome(b, deadline, std::move(handler));
+			}, err);
+		}
+
+		auto AsyncWriteSome(const util::buffer::ConstBuffer &b, util::error::Error &err) {
+			return AsyncWriteSome(b, util::io::NO_DEADLINE, err);
+		}
+
+		auto AsyncWriteSome(const util::buffer::ConstBuffer &b, const util::io::Deadline &deadline, util::error::Error &err) {
+			return util::io::Await([this, b, deadline](Handler handler) {
+				AsyncWriteSome(b, deadline, std::move(handler));
+			}, err);
+		}
+
+		auto AsyncConnect(const Endpoint &pe, const util::io::Deadline &deadline, util::error::Error &err) {
+			return util::io::Await([this, pe, deadline](Handler handler) {
+				AsyncConnect(pe, deadline, std::move(handler));
+			}, err);
+		}
+#endif
+
+	private:
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+		bool _zc_enabled = false;
+		uint32_t _zc_next = 0;
+		size_t _zc_copied = 0;
+		std::deque<std::pair<uint32_t, std::shared_ptr<const void>>> _zc_pending;
+#endif
+
+		class ReceiveOperation : public util::io::Reactor::Operation {
+		public:
+			ReceiveOperation(native::Handle s, const util::buffer::MutableBuffer &b, Handler handler) noexcept
+				: _s(s), _b(b), _nread(0), _handler(std::move(handler)) {}
+
+			bool Perform() override {
+				native::SSize ret = native::Receive(_s, _b.Data(), _b.Size(), 0);
+				if (ret == 0) {
+					if (_b.Size() > 0) {
+						_err = network::error::NetworkError(network::error::NetworkErrorCode::CLOSED);
+					}
+					return true;
+				}
+				if (ret < 0) {
+					int ec = native::LastError();
+					if (ec == EINTR) {
+						return Perform();
+					}
+					if (native::WouldBlock(ec)) {
+						return false;
+					}
+					_err = util::error::lib::SocketError(ec);
+					return true;
+				}
+
+				_nread = (size_t)ret;
+				return true;
+			}
+
+			void Complete() override {
+				_handler(_err, _nread);
+			}
+
+		private:
+			native::Handle _s;
+			util::buffer::MutableBuffer _b;
+			size_t _nread;
+			Handler _handler;
+		};
+
+		class ConnectOperation : public util::io::Reactor::Operation {
+		public:
+			ConnectOperation(native::Handle s, const Endpoint &pe, Handler handler) noexcept
+				: _s(s), _pe(pe), _started(false), _handler(std::move(handler)) {}
+
+			// connects on the first call, then collects the outcome once the socket turns writable
+			bool Perform() override {
+				if (!_started) {
+					_started = true;
+					int ret = connect(_s, _pe.Data(), _pe.Size());
+					if (ret == 0) {
+						return true;
+					}
+
+					int ec = native::LastError();
+					if (native::InProgress(ec)) {
+						return false;
+					}
+					_err = util::error::lib::SocketError(ec, "connect");
+					return true;
+				}
+
+				int ec = native::SocketError(_s);
+				if (ec != 0) {
+					_err = util::error::lib::SocketError(ec, "connect");
+				}
+				return true;
+			}
+
+			void Complete() override {
+				_handler(_err, 0);
+			}
+
+		private:
+			native::Handle _s;
+			Endpoint _pe;
+			bool _started;
+			Handler _handler;
+		};
+
+		class SendOperation : public util::io::Reactor::Operation {
+		public:
+			SendOperation(native::Handle s, const util::buffer::ConstBuffer &b, Handler handler) noexcept
+				: _s(s), _b(b), _nwrite(0), _handler(std::move(handler)) {}
+
+			bool Perform() override {
+				native::SSize ret = native::Send(_s, _b.Data(), _b.Size(), 0);
+				if (ret < 0) {
+					int ec = native::LastError();
+					if (ec == EINTR) {
+						return Perform();
+					}
+					if (native::WouldBlock(ec)) {
+						return false;
+					}
+					_err = util::error::lib::SocketError(ec);
+					return true;
+				}
+
+				_nwrite = (size_t)ret;
+				return true;
+			}
+
+			void Complete() override {
+				_handler(_err, _nwrite);
+			}
+
+		private:
+			native::Handle _s;
+			util::buffer::ConstBuffer _b;
+			size_t _nwrite;
+			Handler _handler;
+		};
+#endif
 	};
 
 }
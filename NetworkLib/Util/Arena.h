@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+namespace util {
+
+	namespace buffer {
+
+		// Monotonic allocator for short-lived bytes: allocations are bumped out of blocks that
+		// never move and are only reclaimed all at once by Clear, which keeps the first block.
+		class Arena {
+		public:
+			explicit Arena(size_t block_size = 1024) noexcept
+				: _block_size(block_size), _cur(0), _used(0) {}
+
+			Arena(const Arena &) = delete;
+			Arena &operator=(const Arena &) = delete;
+
+			virtual ~Arena() {}
+
+			char *Allocate(size_t n) {
+				if (_blocks.empty() || ((_used + n) > Size(_cur))) {
+					Next(n);
+				}
+
+				char *p = _blocks[_cur].first.get() + _used;
+				_used += n;
+				return p;
+			}
+
+			void Clear() {
+				if (_blocks.size() > 1) {
+					_blocks.resize(1);
+				}
+				_cur = 0;
+				_used = 0;
+			}
+
+		private:
+			size_t _block_size;
+			std::vector<std::pair<std::unique_ptr<char[]>, size_t>> _blocks;
+			size_t _cur;
+			size_t _used;
+
+		private:
+			size_t Size(size_t i) const noexcept {
+				return _blocks[i].second;
+			}
+
+			void Next(size_t n) {
+				size_t size = (std::max)(n, _block_size);
+				_blocks.emplace_back(std::unique_ptr<char[]>(new char[size]), size);
+				_cur = _blocks.size() - 1;
+				_used = 0;
+			}
+		};
+
+	}
+
+}
\ No newline at end of file
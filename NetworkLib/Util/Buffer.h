@@ -1,7 +1,12 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <limits>
+#include <vector>
+#include <iterator>
 #include <algorithm>
+#include <type_traits>
 
 namespace util {
 
@@ -58,6 +63,11 @@ namespace util {
 			ConstBuffer(const ConstBuffer &b) noexcept
 				: _data(b._data), _size(b._size) {}
 
+			ConstBuffer(const MutableBuffer &b) noexcept
+				: _data(b.Data()), _size(b.Size()) {}
+
+			ConstBuffer &operator=(const ConstBuffer &b) = default;
+
 			template<typename Elem, typename Traits, typename Allocator>
 			static ConstBuffer From(const std::basic_string<Elem, Traits, Allocator> &data) {
 				return ConstBuffer(data.size() ? &data[0] : nullptr, data.size());
@@ -102,6 +112,104 @@ namespace util {
 			size_t _size;
 		};
 
+		using MutableBufferSequence = std::vector<MutableBuffer>;
+		using ConstBufferSequence = std::vector<ConstBuffer>;
+
+		template<class T, class = void>
+		struct IsMutableBufferSequence : std::false_type {};
+
+		template<class T>
+		struct IsMutableBufferSequence<T, std::void_t<typename T::value_type, decltype(std::begin(std::declval<const T &>()))>>
+			: std::is_convertible<typename T::value_type, MutableBuffer> {};
+
+		template<class T, class = void>
+		struct IsConstBufferSequence : std::false_type {};
+
+		template<class T>
+		struct IsConstBufferSequence<T, std::void_t<typename T::value_type, decltype(std::begin(std::declval<const T &>()))>>
+			: std::is_convertible<typename T::value_type, ConstBuffer> {};
+
+		template<class BufferSequence>
+		size_t BufferSize(const BufferSequence &bs) noexcept {
+			size_t size = 0;
+			for (auto const &b : bs) {
+				size += b.Size();
+			}
+			return size;
+		}
+
+		// Tracks how much of a buffer sequence has been transferred and yields the remaining part
+		template<class Buffer, class BufferSequence>
+		class ConsumingBuffers {
+		public:
+			using Iterator = decltype(std::begin(std::declval<const BufferSequence &>()));
+
+		public:
+			explicit ConsumingBuffers(const BufferSequence &bs, size_t max_buffers = 64)
+				: _cur(std::begin(bs)),
+				_end(std::end(bs)),
+				_off(0),
+				_total(0),
+				_max_buffers(max_buffers) {
+				Skip();
+			}
+
+			bool Empty() const noexcept {
+				return (_cur == _end);
+			}
+
+			size_t Total() const noexcept {
+				return _total;
+			}
+
+			const std::vector<Buffer> &Prepare() {
+				_prepared.clear();
+				Buffer b;
+				for (Iterator i = _cur; (i != _end) && (_prepared.size() < _max_buffers); ++i) {
+					b = Buffer(*i);
+					if (i == _cur) {
+						b += _off;
+					}
+					if (b.Size() > 0) {
+						_prepared.push_back(b);
+					}
+				}
+				return _prepared;
+			}
+
+			void Consume(size_t n) {
+				_total += n;
+				while ((n > 0) && (_cur != _end)) {
+					size_t left = Buffer(*_cur).Size() - _off;
+					if (n < left) {
+						_off += n;
+						return;
+					}
+
+					n -= left;
+					++_cur;
+					_off = 0;
+				}
+				Skip();
+			}
+
+		private:
+			Iterator _cur;
+			Iterator _end;
+			size_t _off;
+			size_t _total;
+			size_t _max_buffers;
+			std::vector<Buffer> _prepared;
+
+		private:
+			void Skip() {
+				while ((_cur != _end) && (Buffer(*_cur).Size() == _off)) {
+					++_cur;
+					_off = 0;
+				}
+			}
+		};
+
 		template<typename Elem, typename Traits, typename Allocator>
 		class DynamicStringBuffer {
 		public:
@@ -168,6 +276,11 @@ namespace util {
 				_size -= consume_size;
 			}
 
+			// the first n elements in place, valid until the next Prepare or Consume
+			std::basic_string_view<Elem, Traits> View(size_t n) const noexcept {
+				return std::basic_string_view<Elem, Traits>(_s.data(), (std::min)(n, _size));
+			}
+
 		// iterator
 		public:
 			const_iterator begin() const {
@@ -0,0 +1,372 @@
+#pragma once
+
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+#include <algorithm>
+
+#include <Util/Error.h>
+#include <Util/Buffer.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace util {
+
+	namespace buffer {
+
+		// Thread-safe pool of uninitialized transfer buffers in power of two size classes.
+		// Released blocks go to a small cache of the releasing thread first and then to a
+		// shared free list; memory is only given back when the pool and every thread that
+		// cached its blocks are gone.
+		class BufferPool {
+		private:
+			class Core;
+
+		public:
+			struct Stats {
+				uint64_t hits;
+				uint64_t misses;
+				size_t in_use;
+				size_t allocated;
+				size_t high_water;
+
+				double HitRate() const noexcept {
+					uint64_t total = hits + misses;
+					return total ? ((double)hits / (double)total) : 0.0;
+				}
+			};
+
+			// owns a pooled block and returns it on destruction
+			class Block {
+			public:
+				friend class BufferPool;
+
+			public:
+				Block() noexcept
+					: _data(nullptr), _size(0) {}
+
+				Block(Block &&b) noexcept
+					: _core(std::move(b._core)),
+					_data(std::exchange(b._data, nullptr)),
+					_size(std::exchange(b._size, 0)) {}
+
+				Block &operator=(Block &&b) noexcept {
+					if (this != &b) {
+						Release();
+						_core = std::move(b._core);
+						_data = std::exchange(b._data, nullptr);
+						_size = std::exchange(b._size, 0);
+					}
+					return *this;
+				}
+
+				Block(const Block &) = delete;
+				Block &operator=(const Block &) = delete;
+
+				virtual ~Block() {
+					Release();
+				}
+
+				char *Data() const noexcept {
+					return _data;
+				}
+
+				// the usable size, at least the size asked for
+				size_t Size() const noexcept {
+					return _size;
+				}
+
+				explicit operator bool() const noexcept {
+					return (_data != nullptr);
+				}
+
+				MutableBuffer Buffer() const noexcept {
+					return MutableBuffer(_data, _size);
+				}
+
+				ConstBuffer Buffer(size_t n) const noexcept {
+					return ConstBuffer(_data, (std::min)(n, _size));
+				}
+
+				void Release() noexcept {
+					if (_data) {
+						_core->Release(_data, _size);
+						_data = nullptr;
+						_size = 0;
+					}
+					_core.reset();
+				}
+
+			private:
+				std::shared_ptr<Core> _core;
+				char *_data;
+				size_t _size;
+
+			private:
+				Block(std::shared_ptr<Core> core, char *data, size_t size) noexcept
+					: _core(std::move(core)), _data(data), _size(size) {}
+			};
+
+		public:
+			// with huge_pages fresh blocks are carved from 2 MiB slabs backed by huge pages where available
+			explicit BufferPool(bool huge_pages = false)
+				: _core(std::make_shared<Core>(huge_pages)) {}
+
+			BufferPool(const BufferPool &) = delete;
+			BufferPool &operator=(const BufferPool &) = delete;
+
+			// the process-wide pool used by default
+			static BufferPool &Default() {
+				// never destroyed, blocks may be released during static destruction
+				static BufferPool *pool = new BufferPool();
+				return *pool;
+			}
+
+			Block Acquire(size_t size) {
+				size_t cls = Class(size);
+				if (cls >= CLASSES) {
+					return Block();
+				}
+
+				char *data = _core->Acquire(cls);
+				return data ? Block(_core, data, ClassSize(cls)) : Block();
+			}
+
+			Stats GetStats() const noexcept {
+				return _core->GetStats();
+			}
+
+		private:
+			static constexpr size_t MIN_SHIFT = 12;
+			static constexpr size_t CLASSES = 20;
+			static constexpr size_t THREAD_CACHE_BLOCKS = 8;
+			static constexpr size_t SLAB_SIZE = 2 * 1024 * 1024;
+
+			std::shared_ptr<Core> _core;
+
+		private:
+			static size_t ClassSize(size_t cls) noexcept {
+				return (size_t)1 << (cls + MIN_SHIFT);
+			}
+
+			static size_t Class(size_t size) noexcept {
+				size_t cls = 0;
+				while ((cls < CLASSES) && (ClassSize(cls) < size)) {
+					++cls;
+				}
+				return cls;
+			}
+
+			// blocks cached by the current thread, flushed to the shared lists when the thread exits
+			class ThreadCache {
+			public:
+				struct Entry {
+					std::shared_ptr<Core> core;
+					std::vector<char *> blocks[CLASSES];
+				};
+
+			public:
+				ThreadCache() = default;
+				ThreadCache(const ThreadCache &) = delete;
+				ThreadCache &operator=(const ThreadCache &) = delete;
+
+				virtual ~ThreadCache() {
+					Closed() = true;
+					for (auto &e : _entries) {
+						e.core->Flush(e.blocks);
+					}
+				}
+
+				// null once the thread is exiting, blocks then go straight to the shared lists
+				static Entry *Get(Core *core) {
+					if (Closed()) {
+						return nullptr;
+					}
+
+					thread_local ThreadCache cache;
+					for (auto &e : cache._entries) {
+						if (e.core.get() == core) {
+							return &e;
+						}
+					}
+					cache._entries.emplace_back();
+					cache._entries.back().core = core->shared_from_this();
+					return &cache._entries.back();
+				}
+
+			private:
+				std::vector<Entry> _entries;
+
+			private:
+				static bool &Closed() noexcept {
+					thread_local bool closed = false;
+					return closed;
+				}
+			};
+
+			class Core : public std::enable_shared_from_this<Core> {
+			public:
+				explicit Core(bool huge_pages) noexcept
+					: _huge_pages(huge_pages),
+					_hits(0),
+					_misses(0),
+					_in_use(0),
+					_allocated(0),
+					_high_water(0),
+					_slab(nullptr),
+					_slab_left(0) {}
+
+				Core(const Core &) = delete;
+				Core &operator=(const Core &) = delete;
+
+				virtual ~Core() {
+					for (size_t cls = 0; cls < CLASSES; cls++) {
+						for (char *p : _free[cls]) {
+							if (!FromSlab(p)) {
+								delete[] p;
+							}
+						}
+					}
+#if defined(__linux__)
+					for (auto &s : _slabs) {
+						munmap(s.first, s.second);
+					}
+#endif
+				}
+
+				char *Acquire(size_t cls) {
+					size_t size = ClassSize(cls);
+					char *p = nullptr;
+
+					ThreadCache::Entry *cache = ThreadCache::Get(this);
+					if (cache && !cache->blocks[cls].empty()) {
+						p = cache->blocks[cls].back();
+						cache->blocks[cls].pop_back();
+					}
+					else {
+						std::lock_guard<std::mutex> lg(_mutex);
+						if (!_free[cls].empty()) {
+							p = _free[cls].back();
+							_free[cls].pop_back();
+						}
+					}
+
+					if (p) {
+						++_hits;
+					}
+					else {
+						p = Allocate(size);
+						if (!p) {
+							return nullptr;
+						}
+						++_misses;
+						_allocated += size;
+					}
+
+					size_t in_use = (_in_use += size);
+					size_t high_water = _high_water.load();
+					while ((in_use > high_water) && !_high_water.compare_exchange_weak(high_water, in_use)) {}
+					return p;
+				}
+
+				void Release(char *p, size_t size) {
+					size_t cls = Class(size);
+					_in_use -= size;
+
+					ThreadCache::Entry *cache = ThreadCache::Get(this);
+					if (cache && (cache->blocks[cls].size() < THREAD_CACHE_BLOCKS)) {
+						cache->blocks[cls].push_back(p);
+						return;
+					}
+
+					std::lock_guard<std::mutex> lg(_mutex);
+					_free[cls].push_back(p);
+				}
+
+				void Flush(std::vector<char *> (&blocks)[CLASSES]) {
+					std::lock_guard<std::mutex> lg(_mutex);
+					for (size_t cls = 0; cls < CLASSES; cls++) {
+						_free[cls].insert(_free[cls].end(), blocks[cls].begin(), blocks[cls].end());
+						blocks[cls].clear();
+					}
+				}
+
+				Stats GetStats() const noexcept {
+					return { _hits.load(), _misses.load(), _in_use.load(), _allocated.load(), _high_water.load() };
+				}
+
+			private:
+				bool _huge_pages;
+
+				std::atomic<uint64_t> _hits;
+				std::atomic<uint64_t> _misses;
+				std::atomic<size_t> _in_use;
+				std::atomic<size_t> _allocated;
+				std::atomic<size_t> _high_water;
+
+				std::mutex _mutex;
+				std::vector<char *> _free[CLASSES];
+
+				std::vector<std::pair<char *, size_t>> _slabs;
+				char *_slab;
+				size_t _slab_left;
+
+			private:
+				char *Allocate(size_t size) {
+#if defined(__linux__)
+					if (_huge_pages) {
+						std::lock_guard<std::mutex> lg(_mutex);
+						if (char *p = Carve(size)) {
+							return p;
+						}
+					}
+#endif
+					return new (std::nothrow) char[size];
+				}
+
+#if defined(__linux__)
+				// a slab too short for the next block is left as it is
+				char *Carve(size_t size) {
+					if (_slab_left < size) {
+						size_t slab_size = (std::max)(size, SLAB_SIZE);
+						void *p = mmap(nullptr, slab_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+						if (p == MAP_FAILED) {
+							// no reserved huge pages, ask for transparent ones instead
+							p = mmap(nullptr, slab_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+							if (p == MAP_FAILED) {
+								return nullptr;
+							}
+							madvise(p, slab_size, MADV_HUGEPAGE);
+						}
+						_slabs.emplace_back(static_cast<char *>(p), slab_size);
+						_slab = static_cast<char *>(p);
+						_slab_left = slab_size;
+					}
+
+					char *p = _slab;
+					_slab += size;
+					_slab_left -= size;
+					return p;
+				}
+#endif
+
+				bool FromSlab(const char *p) const noexcept {
+					for (auto &s : _slabs) {
+						if ((p >= s.first) && (p < s.first + s.second)) {
+							return true;
+						}
+					}
+					return false;
+				}
+			};
+		};
+
+	}
+
+}
\ No newline at end of file
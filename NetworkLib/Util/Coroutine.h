@@ -0,0 +1,258 @@
+#pragma once
+
+#if defined(__linux__) && defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <atomic>
+#include <utility>
+#include <exception>
+#include <type_traits>
+#include <coroutine>
+
+#include <Util/Error.h>
+#include <Util/Reactor.h>
+
+#define UTIL_COROUTINE
+
+namespace util {
+
+	namespace io {
+
+		template<class T = void>
+		class Task;
+
+		namespace coroutine {
+
+			class PromiseBase {
+			public:
+				struct FinalAwaiter {
+					bool await_ready() const noexcept {
+						return false;
+					}
+
+					template<class Promise>
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+						auto continuation = h.promise()._continuation;
+						return continuation ? continuation : std::noop_coroutine();
+					}
+
+					void await_resume() const noexcept {}
+				};
+
+			public:
+				std::suspend_always initial_suspend() const noexcept {
+					return {};
+				}
+
+				FinalAwaiter final_suspend() const noexcept {
+					return {};
+				}
+
+				// errors are reported through util::error::Error, never thrown
+				void unhandled_exception() const noexcept {
+					std::terminate();
+				}
+
+				void SetContinuation(std::coroutine_handle<> continuation) noexcept {
+					_continuation = continuation;
+				}
+
+			private:
+				std::coroutine_handle<> _continuation;
+			};
+
+			template<class T>
+			class Promise : public PromiseBase {
+			public:
+				Task<T> get_return_object() noexcept;
+
+				template<class U>
+				void return_value(U &&value) {
+					_value = std::forward<U>(value);
+				}
+
+				T &Value() noexcept {
+					return _value;
+				}
+
+			private:
+				T _value;
+			};
+
+			template<>
+			class Promise<void> : public PromiseBase {
+			public:
+				Task<void> get_return_object() noexcept;
+
+				void return_void() const noexcept {}
+			};
+
+			// fire and forget: starts right away and frees itself when done
+			struct Detached {
+				struct promise_type {
+					Detached get_return_object() const noexcept {
+						return {};
+					}
+
+					std::suspend_never initial_suspend() const noexcept {
+						return {};
+					}
+
+					std::suspend_never final_suspend() const noexcept {
+						return {};
+					}
+
+					void return_void() const noexcept {}
+
+					void unhandled_exception() const noexcept {
+						std::terminate();
+					}
+				};
+			};
+
+		}
+
+		// lazily started coroutine; co_await runs it and resumes the awaiter once it returns
+		template<class T>
+		class Task {
+		public:
+			using promise_type = coroutine::Promise<T>;
+			using Handle = std::coroutine_handle<promise_type>;
+
+		public:
+			explicit Task(Handle h) noexcept
+				: _h(h) {}
+
+			Task(Task &&t) noexcept
+				: _h(std::exchange(t._h, nullptr)) {}
+
+			Task &operator=(Task &&t) noexcept {
+				if (this != &t) {
+					Destroy();
+					_h = std::exchange(t._h, nullptr);
+				}
+				return *this;
+			}
+
+			Task(const Task &) = delete;
+			Task &operator=(const Task &) = delete;
+
+			virtual ~Task() {
+				Destroy();
+			}
+
+			bool await_ready() const noexcept {
+				return !_h || _h.done();
+			}
+
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+				_h.promise().SetContinuation(awaiter);
+				return _h;
+			}
+
+			auto await_resume() {
+				if constexpr (std::is_void_v<T>) {
+					return;
+				}
+				else {
+					return std::move(_h.promise().Value());
+				}
+			}
+
+		private:
+			Handle _h;
+
+		private:
+			void Destroy() noexcept {
+				if (_h) {
+					_h.destroy();
+					_h = nullptr;
+				}
+			}
+		};
+
+		template<class T>
+		Task<T> coroutine::Promise<T>::get_return_object() noexcept {
+			return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+		}
+
+		inline Task<void> coroutine::Promise<void>::get_return_object() noexcept {
+			return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+		}
+
+		// resumes the awaiting coroutine on the reactor thread
+		class Schedule {
+		public:
+			explicit Schedule(Reactor &reactor) noexcept
+				: _reactor(reactor) {}
+
+			bool await_ready() const noexcept {
+				return false;
+			}
+
+			void await_suspend(std::coroutine_handle<> h) {
+				_reactor.Post([h] {
+					h.resume();
+				});
+			}
+
+			void await_resume() const noexcept {}
+
+		private:
+			Reactor &_reactor;
+		};
+
+		// adapts an operation started as start(handler), with handler(err, n), to co_await;
+		// err receives the error and the result of co_await is n
+		template<class Start>
+		class Awaitable {
+		public:
+			Awaitable(Start start, util::error::Error &err) noexcept
+				: _start(std::move(start)), _err(err), _n(0), _handoff(false) {}
+
+			bool await_ready() const noexcept {
+				return false;
+			}
+
+			// The handler may run on another reactor thread before _start returns. Whichever of the
+			// two finishes second goes on with the coroutine: the handler resumes h, or
+			// await_suspend returns false so that h is not suspended at all.
+			bool await_suspend(std::coroutine_handle<> h) {
+				_start([this, h](const util::error::Error &err, size_t n) {
+					_err = err;
+					_n = n;
+					if (_handoff.exchange(true, std::memory_order_acq_rel)) {
+						h.resume();
+					}
+				});
+				return !_handoff.exchange(true, std::memory_order_acq_rel);
+			}
+
+			size_t await_resume() const noexcept {
+				return _n;
+			}
+
+		private:
+			Start _start;
+			util::error::Error &_err;
+			size_t _n;
+			std::atomic<bool> _handoff;
+		};
+
+		template<class Start>
+		Awaitable<Start> Await(Start start, util::error::Error &err) noexcept {
+			return Awaitable<Start>(std::move(start), err);
+		}
+
+		// runs t on the reactor thread without waiting for it
+		inline void Spawn(Reactor &reactor, Task<void> t) {
+			[](Reactor &reactor, Task<void> t) -> coroutine::Detached {
+				co_await Schedule(reactor);
+				co_await t;
+			}(reactor, std::move(t));
+		}
+
+	}
+
+}
+
+#endif
\ No newline at end of file
@@ -24,8 +24,8 @@ namespace util {
         kind##Error(const kind##Error &err) = default; \
         kind##Error &operator=(kind##Error &&err) = default; \
         kind##Error &operator=(const kind##Error &err) = default; \
-		Error Error() const noexcept { \
-			return Error::From(*this); \
+		::util::error::Error Error() const noexcept { \
+			return ::util::error::Error::From(*this); \
 		} \
         const char *Kind() const override { \
             return _kind.c_str(); \
@@ -80,6 +80,10 @@ namespace util {
 
 			virtual const char *Kind() const = 0;
 
+			int Code() const noexcept {
+				return _code;
+			}
+
 			operator bool() const {
 				return (_code != 0);
 			}
@@ -116,6 +120,12 @@ namespace util {
 				return (_err && !!(*_err));
 			}
 
+			// e.g. err.Is<IOError>(IOErrorCode::TIMED_OUT)
+			template<class T, class Code>
+			bool Is(Code code) const noexcept {
+				return _err && (dynamic_cast<const T *>(_err.get()) != nullptr) && (_err->Code() == static_cast<int>(code));
+			}
+
 			template<class T>
 			static
 				std::enable_if_t<std::is_base_of_v<BasicError, T>, Error>
@@ -139,6 +149,8 @@ namespace util {
 			READ_FAILED,
 			WRITE_FAILED,
 			READ_INTO_NULL,
+			OPERATION_ABORTED,
+			TIMED_OUT,
 		};
 
 		REGISTER_ERROR(IO);
@@ -156,6 +168,9 @@ namespace util {
 			using SocketErrorCode = int;
 			REGISTER_ERROR(Socket);
 
+			using SystemErrorCode = int;
+			REGISTER_ERROR(System);
+
 		}
 
 	}
@@ -1,47 +1,161 @@
 #pragma once
 
 #include <functional>
+#include <type_traits>
 
 #include <Util/Error.h>
+#include <Util/Timer.h>
 #include <Util/Buffer.h>
 #include <Util/String.h>
 #include <Util/Thread.h>
+#include <Util/Reactor.h>
+#include <Util/Coroutine.h>
 
 namespace util {
 
 	namespace io {
 
-		using IOContext = util::thread::ThreadPool;
+		class IOContext : public util::thread::ThreadPool {
+		public:
+			explicit IOContext(size_t size) noexcept
+				: ThreadPool(size) {}
 
-		template<typename SyncReadStream, typename MutableBuffer>
-		size_t Read(SyncReadStream &s, const MutableBuffer &b, util::error::Error &err) {
+			virtual ~IOContext() {
+				Stop();
+			}
+
+			void Stop() noexcept {
+#if defined(__linux__)
+				_reactor.Stop();
+#endif
+				ThreadPool::Stop();
+			}
+
+#if defined(__linux__)
+			void Run() {
+				_reactor.Run();
+			}
+
+			Reactor &GetReactor() noexcept {
+				return _reactor;
+			}
+
+		private:
+			Reactor _reactor;
+#endif
+		};
+
+		// forwards to the deadline overloads of ReadSome/WriteSome, so that the composed
+		// operations below can bound a whole read or write
+		template<typename SyncStream>
+		class DeadlineStream {
+		public:
+			DeadlineStream(SyncStream &s, const Deadline &deadline) noexcept
+				: _s(s), _deadline(deadline) {}
+
+			template<typename MutableBuffers>
+			size_t ReadSome(const MutableBuffers &bs, util::error::Error &err) {
+				return _s.ReadSome(bs, _deadline, err);
+			}
+
+			template<typename ConstBuffers>
+			size_t WriteSome(const ConstBuffers &bs, util::error::Error &err) {
+				return _s.WriteSome(bs, _deadline, err);
+			}
+
+#ifdef UTIL_COROUTINE
+			auto AsyncReadSome(const util::buffer::MutableBuffer &b, util::error::Error &err) {
+				return _s.AsyncReadSome(b, _deadline, err);
+			}
+
+			auto AsyncWriteSome(const util::buffer::ConstBuffer &b, util::error::Error &err) {
+				return _s.AsyncWriteSome(b, _deadline, err);
+			}
+#endif
+
+		private:
+			SyncStream &_s;
+			Deadline _deadline;
+		};
+
+		template<typename SyncReadStream>
+		size_t Read(SyncReadStream &s, const util::buffer::MutableBuffer &b, util::error::Error &err) {
 			for (size_t nread = 0; nread < b.Size();) {
 				nread += s.ReadSome(b + nread, err);
-				if (ec) {
+				if (err) {
 					return nread;
 				}
 			}
 			return b.Size();
 		}
 
+		template<typename SyncReadStream, typename MutableBufferSequence>
+		std::enable_if_t<util::buffer::IsMutableBufferSequence<MutableBufferSequence>::value, size_t>
+			Read(SyncReadStream &s, const MutableBufferSequence &bs, util::error::Error &err) {
+			util::buffer::ConsumingBuffers<util::buffer::MutableBuffer, MutableBufferSequence> cb(bs);
+			while (!cb.Empty()) {
+				cb.Consume(s.ReadSome(cb.Prepare(), err));
+				if (err) {
+					break;
+				}
+			}
+			return cb.Total();
+		}
+
+		namespace detail {
+
+			template<size_t STATES>
+			const util::string::Matcher<STATES> &ToMatcher(const util::string::Matcher<STATES> &matcher) noexcept {
+				return matcher;
+			}
+
+			// built on every call, hot paths pass a constexpr matcher instead
+			template<size_t ...N>
+			constexpr auto ToMatcher(const char (&...patterns)[N]) noexcept {
+				return util::string::MakeMatcher(patterns...);
+			}
+
+			// resumes at nsearched and leaves it past the delimiter when one is found; buffers whose
+			// iterators are pointers are searched vectorized, others byte by byte carrying state along
+			template<typename DynamicBuffer, size_t STATES>
+			bool Search(const DynamicBuffer &b, const util::string::Matcher<STATES> &matcher, util::string::MatchState &state, size_t &nsearched) {
+				if constexpr (std::is_pointer<typename DynamicBuffer::const_iterator>::value) {
+					size_t n = matcher.Search(b.begin(), b.end(), nsearched);
+					if (n == util::string::Matcher<STATES>::npos) {
+						nsearched = b.Size();
+						return false;
+					}
+
+					nsearched = n;
+					return true;
+				}
+				else {
+					auto cur = b.begin() + nsearched;
+					auto end = b.end();
+					for (; cur != end; ++cur) {
+						++nsearched;
+						if (matcher.Consume(state, *cur)) {
+							return true;
+						}
+					}
+					return false;
+				}
+			}
+
+		}
+
 		template<typename SyncReadStream, typename DynamicBuffer, typename ...Patterns>
 		size_t ReadUntil(SyncReadStream &s, DynamicBuffer &b, util::error::Error &err, Patterns &&...patterns) {
 			size_t bsize = 0;
 			size_t nread = 0;
 			size_t nsearched = 0;
-			DynamicBuffer::const_iterator cur;
-			DynamicBuffer::const_iterator end;
-			util::string::Pattern<DynamicBuffer::ValueType> pattern(std::forward<Patterns>(patterns)...);
+			util::string::MatchState state = 0;
+			const auto &matcher = detail::ToMatcher(patterns...);
 			for (;;) {
 				bsize = b.Size();
 
-				cur = b.begin() + nsearched;
-				end = b.end();
-				for (; cur != end; ++cur) {
-					++nsearched;
-					if (pattern.Consume(*cur)) {
-						return nsearched;
-					}
+				if (detail::Search(b, matcher, state, nsearched)) {
+					return nsearched;
 				}
 
 				nread = std::min<std::size_t>(
@@ -74,6 +188,114 @@ namespace util {
 			return b.Size();
 		}
 
+		template<typename SyncWriteStream, typename ConstBufferSequence>
+		std::enable_if_t<util::buffer::IsConstBufferSequence<ConstBufferSequence>::value, size_t>
+			Write(SyncWriteStream &s, const ConstBufferSequence &bs, util::error::Error &err) {
+			util::buffer::ConsumingBuffers<util::buffer::ConstBuffer, ConstBufferSequence> cb(bs);
+			while (!cb.Empty()) {
+				cb.Consume(s.WriteSome(cb.Prepare(), err));
+				if (err) {
+					break;
+				}
+			}
+			return cb.Total();
+		}
+
+		template<typename SyncReadStream, typename MutableBuffers>
+		size_t Read(SyncReadStream &s, const MutableBuffers &bs, const Deadline &deadline, util::error::Error &err) {
+			DeadlineStream<SyncReadStream> ds(s, deadline);
+			return Read(ds, bs, err);
+		}
+
+		template<typename SyncReadStream, typename DynamicBuffer, typename ...Patterns>
+		size_t ReadUntil(SyncReadStream &s, DynamicBuffer &b, const Deadline &deadline, util::error::Error &err, Patterns &&...patterns) {
+			DeadlineStream<SyncReadStream> ds(s, deadline);
+			return ReadUntil(ds, b, err, std::forward<Patterns>(patterns)...);
+		}
+
+		template<typename SyncWriteStream, typename ConstBuffers>
+		size_t Write(SyncWriteStream &s, const ConstBuffers &bs, const Deadline &deadline, util::error::Error &err) {
+			DeadlineStream<SyncWriteStream> ds(s, deadline);
+			return Write(ds, bs, err);
+		}
+
+#ifdef UTIL_COROUTINE
+		template<typename AsyncReadStream>
+		Task<size_t> AsyncRead(AsyncReadStream &s, util::buffer::MutableBuffer b, util::error::Error &err) {
+			size_t nread = 0;
+			while (nread < b.Size()) {
+				nread += co_await s.AsyncReadSome(b + nread, err);
+				if (err) {
+					break;
+				}
+			}
+			co_return nread;
+		}
+
+		template<typename AsyncReadStream, typename DynamicBuffer, typename ...Patterns>
+		Task<size_t> AsyncReadUntil(AsyncReadStream &s, DynamicBuffer &b, util::error::Error &err, Patterns &&...patterns) {
+			size_t bsize = 0;
+			size_t nread = 0;
+			size_t nsearched = 0;
+			util::string::MatchState state = 0;
+			const auto &matcher = detail::ToMatcher(patterns...);
+			for (;;) {
+				bsize = b.Size();
+
+				if (detail::Search(b, matcher, state, nsearched)) {
+					co_return nsearched;
+				}
+
+				nread = std::min<std::size_t>(
+					std::max<size_t>(512, b.Capacity() - bsize),
+					std::min<size_t>(65536, b.MaxSize() - bsize));
+
+				auto tmpb = b.Prepare(nread, err);
+				if (err) {
+					break;
+				}
+
+				nread = co_await s.AsyncReadSome(tmpb, err);
+				if (err) {
+					break;
+				}
+
+				b.Commit(nread);
+			}
+			co_return nsearched;
+		}
+
+		template<typename AsyncWriteStream>
+		Task<size_t> AsyncWrite(AsyncWriteStream &s, util::buffer::ConstBuffer b, util::error::Error &err) {
+			size_t nwrite = 0;
+			while (nwrite < b.Size()) {
+				nwrite += co_await s.AsyncWriteSome(b + nwrite, err);
+				if (err) {
+					break;
+				}
+			}
+			co_return nwrite;
+		}
+
+		template<typename AsyncReadStream>
+		Task<size_t> AsyncRead(AsyncReadStream &s, util::buffer::MutableBuffer b, Deadline deadline, util::error::Error &err) {
+			DeadlineStream<AsyncReadStream> ds(s, deadline);
+			co_return co_await AsyncRead(ds, b, err);
+		}
+
+		template<typename AsyncReadStream, typename DynamicBuffer, typename ...Patterns>
+		Task<size_t> AsyncReadUntil(AsyncReadStream &s, DynamicBuffer &b, Deadline deadline, util::error::Error &err, Patterns &&...patterns) {
+			DeadlineStream<AsyncReadStream> ds(s, deadline);
+			co_return co_await AsyncReadUntil(ds, b, err, std::forward<Patterns>(patterns)...);
+		}
+
+		template<typename AsyncWriteStream>
+		Task<size_t> AsyncWrite(AsyncWriteStream &s, util::buffer::ConstBuffer b, Deadline deadline, util::error::Error &err) {
+			DeadlineStream<AsyncWriteStream> ds(s, deadline);
+			co_return co_await AsyncWrite(ds, b, err);
+		}
+#endif
+
 	}
 
 }
\ No newline at end of file
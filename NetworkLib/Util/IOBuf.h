@@ -0,0 +1,425 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <limits>
+#include <memory>
+#include <cstring>
+#include <iterator>
+#include <algorithm>
+
+#include <Util/Error.h>
+#include <Util/Buffer.h>
+#include <Util/BufferPool.h>
+
+namespace util {
+
+	namespace buffer {
+
+		// Chain of reference counted buffer segments. Copies, slices and splits share the
+		// underlying memory instead of copying bytes; bytes once committed never change, so a
+		// chain may keep writing into the unused tail of memory others still read from.
+		class IOBuf {
+		private:
+			struct Storage {
+				BufferPool::Block block;
+				std::shared_ptr<const std::string> wrapped;
+				char *data;
+				size_t capacity;
+				size_t used;
+			};
+
+			struct Segment {
+				std::shared_ptr<Storage> storage;
+				size_t off;
+				size_t len;
+				bool writable;
+
+				const char *Data() const noexcept {
+					return storage->data + off;
+				}
+
+				// room right after the segment that nobody has seen yet, only the chain that wrote the segment may use it
+				size_t Tailroom() const noexcept {
+					return (writable && ((off + len) == storage->used)) ? (storage->capacity - storage->used) : 0;
+				}
+			};
+
+		public:
+			class const_iterator {
+			public:
+				using iterator_category = std::forward_iterator_tag;
+				using value_type = char;
+				using difference_type = std::ptrdiff_t;
+				using pointer = const char *;
+				using reference = const char &;
+
+			public:
+				const_iterator() noexcept
+					: _segs(nullptr), _seg(0), _off(0) {}
+
+				const_iterator(const std::deque<Segment> *segs, size_t seg, size_t off) noexcept
+					: _segs(segs), _seg(seg), _off(off) {
+					Skip();
+				}
+
+				reference operator*() const noexcept {
+					return (*_segs)[_seg].Data()[_off];
+				}
+
+				const_iterator &operator++() noexcept {
+					++_off;
+					Skip();
+					return *this;
+				}
+
+				const_iterator operator++(int) noexcept {
+					const_iterator i = *this;
+					++(*this);
+					return i;
+				}
+
+				const_iterator operator+(size_t n) const noexcept {
+					const_iterator i = *this;
+					while ((n > 0) && (i._seg < i._segs->size())) {
+						size_t step = (std::min)(n, (*i._segs)[i._seg].len - i._off);
+						i._off += step;
+						n -= step;
+						i.Skip();
+					}
+					return i;
+				}
+
+				bool operator==(const const_iterator &i) const noexcept {
+					return (_seg == i._seg) && (_off == i._off);
+				}
+
+				bool operator!=(const const_iterator &i) const noexcept {
+					return !(*this == i);
+				}
+
+			private:
+				const std::deque<Segment> *_segs;
+				size_t _seg;
+				size_t _off;
+
+			private:
+				void Skip() noexcept {
+					while (_segs && (_seg < _segs->size()) && (_off >= (*_segs)[_seg].len)) {
+						++_seg;
+						_off = 0;
+					}
+				}
+			};
+
+			using ValueType = std::string;
+
+		public:
+			explicit IOBuf(BufferPool &pool = BufferPool::Default(), size_t block_size = 65536) noexcept
+				: _pool(&pool), _block_size(block_size), _size(0), _prepared(0) {}
+
+			IOBuf(const IOBuf &b)
+				: _pool(b._pool),
+				_block_size(b._block_size),
+				_segs(b._segs),
+				_size(b._size),
+				_prepared(0) {
+				Share();
+			}
+
+			IOBuf &operator=(const IOBuf &b) {
+				if (this != &b) {
+					_pool = b._pool;
+					_block_size = b._block_size;
+					_segs = b._segs;
+					_size = b._size;
+					_prepared = 0;
+					Share();
+				}
+				return *this;
+			}
+
+			IOBuf(IOBuf &&b) noexcept
+				: _pool(b._pool),
+				_block_size(b._block_size),
+				_segs(std::move(b._segs)),
+				_size(std::exchange(b._size, 0)),
+				_prepared(std::exchange(b._prepared, 0)) {}
+
+			IOBuf &operator=(IOBuf &&b) noexcept {
+				_pool = b._pool;
+				_block_size = b._block_size;
+				_segs = std::move(b._segs);
+				_size = std::exchange(b._size, 0);
+				_prepared = std::exchange(b._prepared, 0);
+				return *this;
+			}
+
+			virtual ~IOBuf() {}
+
+			// shares s without copying it
+			static IOBuf Wrap(std::shared_ptr<const std::string> s) {
+				IOBuf b;
+				if (s && !s->empty()) {
+					auto storage = std::make_shared<Storage>();
+					storage->data = const_cast<char *>(s->data());
+					storage->capacity = storage->used = s->size();
+					storage->wrapped = std::move(s);
+					b._segs.push_back({ storage, 0, storage->used, false });
+					b._size = storage->used;
+				}
+				return b;
+			}
+
+			size_t Size() const noexcept {
+				return _size;
+			}
+
+			bool Empty() const noexcept {
+				return (_size == 0);
+			}
+
+			size_t MaxSize() const noexcept {
+				return (std::numeric_limits<size_t>::max)();
+			}
+
+			size_t Capacity() const noexcept {
+				return _size + Tailroom();
+			}
+
+			// bytes Prepare can hand out without a new block
+			size_t Tailroom() const noexcept {
+				return _segs.empty() ? 0 : _segs.back().Tailroom();
+			}
+
+			// writable memory after the data: the tail of the last segment if it has room, else a new block
+			MutableBuffer Prepare(size_t n, util::error::Error &err) {
+				_prepared = 0;
+				if (n == 0) {
+					return MutableBuffer();
+				}
+
+				if (_segs.empty() || (_segs.back().Tailroom() < n)) {
+					auto storage = std::make_shared<Storage>();
+					storage->block = _pool->Acquire((std::max)(n, _block_size));
+					if (!storage->block) {
+						err = util::error::RuntimeError(util::error::RuntimeErrorCode::MEMORY_LIMIT_EXCEEDED);
+						return MutableBuffer();
+					}
+					storage->data = storage->block.Data();
+					storage->capacity = storage->block.Size();
+					storage->used = 0;
+
+					if (!_segs.empty() && (_segs.back().len == 0)) {
+						_segs.pop_back();
+					}
+					_segs.push_back({ storage, 0, 0, true });
+				}
+
+				Segment &s = _segs.back();
+				_prepared = n;
+				return MutableBuffer(s.storage->data + s.off + s.len, n);
+			}
+
+			void Commit(size_t n) {
+				n = (std::min)(n, _prepared);
+				_prepared = 0;
+				if (n == 0) {
+					return;
+				}
+
+				Segment &s = _segs.back();
+				s.len += n;
+				s.storage->used += n;
+				_size += n;
+			}
+
+			// shares the segments of b
+			void Append(const IOBuf &b) {
+				for (auto &s : b._segs) {
+					if (s.len > 0) {
+						Push({ s.storage, s.off, s.len, false });
+					}
+				}
+			}
+
+			void Append(IOBuf &&b) {
+				for (auto &s : b._segs) {
+					if (s.len > 0) {
+						Push(std::move(s));
+					}
+				}
+				b.Clear();
+			}
+
+			// copies b, filling the tail of the last segment first
+			void Append(ConstBuffer b, util::error::Error &err) {
+				while (b.Size() > 0) {
+					size_t n = _segs.empty() ? 0 : (std::min)(b.Size(), _segs.back().Tailroom());
+					if (n == 0) {
+						n = (std::min)(b.Size(), _block_size);
+					}
+
+					auto m = Prepare(n, err);
+					if (err) {
+						return;
+					}
+					std::memcpy(m.Data(), b.Data(), n);
+					Commit(n);
+					b += n;
+				}
+			}
+
+			// drops n bytes from the front
+			void Consume(size_t n) {
+				n = (std::min)(n, _size);
+				_size -= n;
+				while (n > 0) {
+					Segment &s = _segs.front();
+					size_t step = (std::min)(n, s.len);
+					s.off += step;
+					s.len -= step;
+					n -= step;
+					if ((s.len == 0) && (_segs.size() > 1)) {
+						_segs.pop_front();
+					}
+				}
+			}
+
+			// moves the first n bytes out into a new chain that shares their memory
+			IOBuf Split(size_t n) {
+				IOBuf front(*_pool, _block_size);
+				n = (std::min)(n, _size);
+				while (n > 0) {
+					Segment &s = _segs.front();
+					size_t step = (std::min)(n, s.len);
+					front.Push({ s.storage, s.off, step, false });
+					n -= step;
+					s.off += step;
+					s.len -= step;
+					_size -= step;
+					// the last segment stays to keep writing into its tail
+					if ((s.len == 0) && (_segs.size() > 1)) {
+						_segs.pop_front();
+					}
+				}
+				return front;
+			}
+
+			// n bytes from off, sharing their memory
+			IOBuf Slice(size_t off, size_t n) const {
+				IOBuf slice(*_pool, _block_size);
+				for (auto &s : _segs) {
+					if (n == 0) {
+						break;
+					}
+					if (off >= s.len) {
+						off -= s.len;
+						continue;
+					}
+
+					size_t step = (std::min)(n, s.len - off);
+					slice.Push({ s.storage, s.off + off, step, false });
+					n -= step;
+					off = 0;
+				}
+				return slice;
+			}
+
+			void Clear() noexcept {
+				_segs.clear();
+				_size = 0;
+				_prepared = 0;
+			}
+
+			// for scatter-gather writes
+			ConstBufferSequence Buffers() const {
+				ConstBufferSequence bs;
+				bs.reserve(_segs.size());
+				for (auto &s : _segs) {
+					if (s.len > 0) {
+						bs.emplace_back(s.Data(), s.len);
+					}
+				}
+				return bs;
+			}
+
+			// makes the data one contiguous segment, copying only if it is spread over several
+			ConstBuffer Coalesce(util::error::Error &err) {
+				if (_size == 0) {
+					return ConstBuffer();
+				}
+
+				size_t count = 0;
+				for (auto &s : _segs) {
+					count += (s.len > 0) ? 1 : 0;
+				}
+
+				if (count > 1) {
+					IOBuf flat(*_pool, _size);
+					for (auto &s : _segs) {
+						flat.Append(ConstBuffer(s.Data(), s.len), err);
+						if (err) {
+							return ConstBuffer();
+						}
+					}
+					flat._block_size = _block_size;
+					*this = std::move(flat);
+				}
+				return ConstBuffer(_segs.front().Data(), _segs.front().len);
+			}
+
+			std::string Str() const {
+				std::string s;
+				s.reserve(_size);
+				for (auto &seg : _segs) {
+					s.append(seg.Data(), seg.len);
+				}
+				return s;
+			}
+
+		// iterator
+		public:
+			const_iterator begin() const noexcept {
+				return const_iterator(&_segs, 0, 0);
+			}
+
+			const_iterator end() const noexcept {
+				return const_iterator(&_segs, _segs.size(), 0);
+			}
+
+		private:
+			BufferPool *_pool;
+			size_t _block_size;
+
+			std::deque<Segment> _segs;
+			size_t _size;
+			size_t _prepared;
+
+		private:
+			void Share() noexcept {
+				for (auto &s : _segs) {
+					s.writable = false;
+				}
+			}
+
+			void Push(Segment s) {
+				_size += s.len;
+				if (!_segs.empty()) {
+					Segment &last = _segs.back();
+					if (last.len == 0) {
+						_segs.pop_back();
+					}
+					else if ((last.storage == s.storage) && ((last.off + last.len) == s.off)) {
+						last.len += s.len;
+						last.writable = s.writable;
+						return;
+					}
+				}
+				_segs.push_back(std::move(s));
+			}
+		};
+
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include <Util/Error.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace util {
+
+	namespace io {
+
+#ifndef _WIN32
+		// Progress of resumable transfers in a small memory-mapped file, one slot per transfer.
+		// A slot is a single 512 byte sector with a checksum, so a write torn by a crash reads
+		// back as a free slot instead of a wrong offset. Thread-safe.
+		class Journal {
+		public:
+			using Slot = size_t;
+
+			static constexpr Slot NO_SLOT = (Slot)-1;
+			static constexpr size_t SLOTS = 255;
+			static constexpr size_t KEY_SIZE = 464;
+
+			struct Entry {
+				uint64_t offset;
+				uint64_t size;
+				// identifies the version of the source, e.g. its mtime
+				int64_t stamp;
+			};
+
+		public:
+			Journal() noexcept
+				: _fd(-1), _map(nullptr) {}
+
+			Journal(const Journal &) = delete;
+			Journal &operator=(const Journal &) = delete;
+
+			virtual ~Journal() {
+				Close();
+			}
+
+			// creates the file if it does not exist yet
+			void Open(const std::string &path, util::error::Error &err) {
+				std::lock_guard<std::mutex> lg(_mutex);
+				if (_map) {
+					return;
+				}
+
+				_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+				if (_fd < 0) {
+					err = util::error::IOError(util::error::IOErrorCode::OPEN_FILE_FAILED, "journal");
+					return;
+				}
+
+				struct stat st;
+				if (fstat(_fd, &st) != 0) {
+					Fail(util::error::IOErrorCode::READ_FAILED, err);
+					return;
+				}
+
+				bool fresh = (st.st_size == 0);
+				if (fresh && (ftruncate(_fd, (off_t)FILE_SIZE) != 0)) {
+					Fail(util::error::IOErrorCode::WRITE_FAILED, err);
+					return;
+				}
+				if (!fresh && ((size_t)st.st_size != FILE_SIZE)) {
+					Fail(util::error::IOErrorCode::READ_FAILED, err);
+					return;
+				}
+
+				void *p = mmap(nullptr, FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+				if (p == MAP_FAILED) {
+					Fail(util::error::IOErrorCode::OPEN_FILE_FAILED, err);
+					return;
+				}
+				_map = static_cast<Record *>(p);
+
+				if (fresh) {
+					std::memcpy(_map[0].key, MAGIC, sizeof(MAGIC));
+					Seal(_map[0]);
+					Sync(0, err);
+					return;
+				}
+
+				if ((std::memcmp(_map[0].key, MAGIC, sizeof(MAGIC)) != 0) || !Intact(_map[0])) {
+					munmap(_map, FILE_SIZE);
+					_map = nullptr;
+					Fail(util::error::IOErrorCode::READ_FAILED, err);
+					return;
+				}
+			}
+
+			void Close() noexcept {
+				std::lock_guard<std::mutex> lg(_mutex);
+				if (_map) {
+					munmap(_map, FILE_SIZE);
+					_map = nullptr;
+				}
+				if (_fd >= 0) {
+					::close(_fd);
+					_fd = -1;
+				}
+			}
+
+			bool IsOpen() const noexcept {
+				return (_map != nullptr);
+			}
+
+			// the last durable progress recorded for key
+			bool Find(const std::string &key, Entry &e) const {
+				std::lock_guard<std::mutex> lg(_mutex);
+				Slot s = Lookup(key);
+				if (s == NO_SLOT) {
+					return false;
+				}
+
+				e = { _map[s].offset, _map[s].size, _map[s].stamp };
+				return true;
+			}
+
+			// starts recording key, in place of an earlier record of it
+			Slot Begin(const std::string &key, const Entry &e, util::error::Error &err) {
+				std::lock_guard<std::mutex> lg(_mutex);
+				if (!_map) {
+					err = util::error::IOError(util::error::IOErrorCode::WRITE_FAILED, "journal");
+					return NO_SLOT;
+				}
+
+				Slot s = Lookup(key);
+				for (Slot i = 1; (s == NO_SLOT) && (i <= SLOTS); i++) {
+					if (!_map[i].used || !Intact(_map[i])) {
+						s = i;
+					}
+				}
+				if (s == NO_SLOT) {
+					err = util::error::IOError(util::error::IOErrorCode::WRITE_FAILED, "journal full");
+					return NO_SLOT;
+				}
+
+				Record &r = _map[s];
+				std::memset(&r, 0, sizeof(r));
+				r.hash = Hash(key);
+				r.key_size = (uint32_t)key.size();
+				std::memcpy(r.key, key.data(), (std::min)(key.size(), KEY_SIZE));
+				r.offset = e.offset;
+				r.size = e.size;
+				r.stamp = e.stamp;
+				r.used = 1;
+				Seal(r);
+				Sync(s, err);
+				return s;
+			}
+
+			// offset is durable once this returns, the data up to offset has to be durable before
+			void Commit(Slot s, uint64_t offset, util::error::Error &err) {
+				std::lock_guard<std::mutex> lg(_mutex);
+				if (!Valid(s)) {
+					return;
+				}
+
+				_map[s].offset = offset;
+				Seal(_map[s]);
+				Sync(s, err);
+			}
+
+			// the transfer is complete, the slot is free again
+			void End(Slot s, util::error::Error &err) {
+				std::lock_guard<std::mutex> lg(_mutex);
+				if (!Valid(s)) {
+					return;
+				}
+
+				std::memset(&_map[s], 0, sizeof(Record));
+				Sync(s, err);
+			}
+
+		private:
+			struct Record {
+				uint64_t checksum;
+				uint64_t hash;
+				uint64_t offset;
+				uint64_t size;
+				int64_t stamp;
+				uint32_t used;
+				uint32_t key_size;
+				// the first KEY_SIZE bytes of the key, the hash covers all of it
+				char key[KEY_SIZE];
+			};
+
+			static_assert(sizeof(Record) == 512, "a record has to fill one sector");
+
+			static constexpr char MAGIC[] = "util::io::Journal 1";
+			static constexpr size_t FILE_SIZE = (SLOTS + 1) * sizeof(Record);
+
+			int _fd;
+			Record *_map;
+			mutable std::mutex _mutex;
+
+		private:
+			// FNV-1a
+			static uint64_t Hash(const void *data, size_t size) noexcept {
+				const unsigned char *p = static_cast<const unsigned char *>(data);
+				uint64_t h = 14695981039346656037ull;
+				for (size_t i = 0; i < size; i++) {
+					h = (h ^ p[i]) * 1099511628211ull;
+				}
+				return h;
+			}
+
+			static uint64_t Hash(const std::string &key) noexcept {
+				return Hash(key.data(), key.size());
+			}
+
+			static uint64_t Checksum(const Record &r) noexcept {
+				return Hash(reinterpret_cast<const char *>(&r) + sizeof(r.checksum), sizeof(Record) - sizeof(r.checksum));
+			}
+
+			static void Seal(Record &r) noexcept {
+				r.checksum = Checksum(r);
+			}
+
+			static bool Intact(const Record &r) noexcept {
+				return (r.checksum == Checksum(r));
+			}
+
+			bool Valid(Slot s) const noexcept {
+				return _map && (s >= 1) && (s <= SLOTS);
+			}
+
+			Slot Lookup(const std::string &key) const noexcept {
+				if (!_map) {
+					return NO_SLOT;
+				}
+
+				uint64_t hash = Hash(key);
+				size_t n = (std::min)(key.size(), KEY_SIZE);
+				for (Slot i = 1; i <= SLOTS; i++) {
+					const Record &r = _map[i];
+					if (r.used && (r.hash == hash) && (r.key_size == key.size()) && (std::memcmp(r.key, key.data(), n) == 0) && Intact(r)) {
+						return i;
+					}
+				}
+				return NO_SLOT;
+			}
+
+			// writes back the page holding slot s
+			void Sync(Slot s, util::error::Error &err) {
+				size_t page = (size_t)sysconf(_SC_PAGESIZE);
+				size_t off = (s * sizeof(Record)) & ~(page - 1);
+				if (msync(reinterpret_cast<char *>(_map) + off, page, MS_SYNC) != 0) {
+					err = util::error::IOError(util::error::IOErrorCode::WRITE_FAILED, "journal");
+				}
+			}
+
+			void Fail(util::error::IOErrorCode code, util::error::Error &err) {
+				err = util::error::IOError(code, "journal");
+				::close(_fd);
+				_fd = -1;
+			}
+		};
+#endif
+
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,365 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <mutex>
+#include <deque>
+#include <queue>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include <cerrno>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <Util/Error.h>
+#include <Util/Timer.h>
+
+namespace util {
+
+	namespace io {
+
+		class Reactor {
+		public:
+			using Task = std::function<void()>;
+
+			enum class OpType {
+				READ = 0,
+				WRITE,
+				MAX,
+			};
+
+			class Operation {
+			public:
+				using Ptr = typename std::shared_ptr<Operation>;
+
+			public:
+				virtual ~Operation() {}
+
+				// returns false if the operation would block and has to wait for readiness
+				virtual bool Perform() = 0;
+
+				virtual void Complete() = 0;
+
+				void Abort(const util::error::Error &err) {
+					_err = err;
+				}
+
+			protected:
+				util::error::Error _err;
+
+			private:
+				friend class Reactor;
+
+				TimerWheel::Timer::Ptr _timer;
+			};
+
+			class Descriptor {
+			public:
+				using Ptr = typename std::shared_ptr<Descriptor>;
+
+				friend class Reactor;
+
+			public:
+				explicit Descriptor(int fd) noexcept
+					: _fd(fd), _registered(true) {}
+
+				int Fd() const noexcept {
+					return _fd;
+				}
+
+			private:
+				int _fd;
+				bool _registered;
+				std::mutex _mutex;
+				std::deque<Operation::Ptr> _ops[static_cast<size_t>(OpType::MAX)];
+			};
+
+		public:
+			Reactor() noexcept
+				: _stopped(false),
+				_wait_until(NO_DEADLINE.time_since_epoch().count()) {
+				_epfd = epoll_create1(EPOLL_CLOEXEC);
+				_evfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+				epoll_event ev;
+				ev.events = EPOLLIN;
+				ev.data.fd = _evfd;
+				epoll_ctl(_epfd, EPOLL_CTL_ADD, _evfd, &ev);
+			}
+
+			Reactor(const Reactor &) = delete;
+			Reactor &operator=(const Reactor &) = delete;
+
+			virtual ~Reactor() {
+				::close(_evfd);
+				::close(_epfd);
+			}
+
+			Descriptor::Ptr Register(int fd, util::error::Error &err) {
+				auto d = std::make_shared<Descriptor>(fd);
+
+				epoll_event ev;
+				ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+				ev.data.fd = fd;
+				if (epoll_ctl(_epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+					err = util::error::lib::SystemError(errno, "epoll_ctl");
+					return nullptr;
+				}
+
+				std::lock_guard<std::mutex> lg(_mutex);
+				_descriptors[fd] = d;
+				return d;
+			}
+
+			void Deregister(const Descriptor::Ptr &d) {
+				if (!d) {
+					return;
+				}
+
+				{
+					std::lock_guard<std::mutex> lg(_mutex);
+					auto i = _descriptors.find(d->_fd);
+					if ((i != _descriptors.end()) && (i->second == d)) {
+						_descriptors.erase(i);
+					}
+				}
+
+				epoll_ctl(_epfd, EPOLL_CTL_DEL, d->_fd, nullptr);
+
+				std::vector<Operation::Ptr> aborted;
+				{
+					std::lock_guard<std::mutex> lg(d->_mutex);
+					d->_registered = false;
+					for (auto &ops : d->_ops) {
+						for (auto &op : ops) {
+							op->Abort(util::error::IOError(util::error::IOErrorCode::OPERATION_ABORTED).Error());
+							aborted.push_back(op);
+						}
+						ops.clear();
+					}
+				}
+
+				for (auto &op : aborted) {
+					Post([op] {
+						Finish(op);
+					});
+				}
+			}
+
+			// the operation completes with TIMED_OUT if it is still pending at the deadline
+			void StartOp(const Descriptor::Ptr &d, OpType t, const Operation::Ptr &op, const Deadline &deadline) {
+				if (deadline != NO_DEADLINE) {
+					std::weak_ptr<Descriptor> wd = d;
+					std::weak_ptr<Operation> wop = op;
+					op->_timer = TimerWheel::Timer::New([this, wd, wop, t] {
+						auto d = wd.lock();
+						auto op = wop.lock();
+						if (d && op) {
+							Cancel(d, t, op, util::error::IOError(util::error::IOErrorCode::TIMED_OUT).Error());
+						}
+					});
+					Arm(*op->_timer, deadline);
+				}
+
+				StartOp(d, t, op);
+			}
+
+			void StartOp(const Descriptor::Ptr &d, OpType t, const Operation::Ptr &op) {
+				{
+					std::lock_guard<std::mutex> lg(d->_mutex);
+					if (!d->_registered) {
+						op->Abort(util::error::IOError(util::error::IOErrorCode::OPERATION_ABORTED).Error());
+					}
+					else {
+						auto &ops = d->_ops[static_cast<size_t>(t)];
+						if (!ops.empty() || !op->Perform()) {
+							ops.push_back(op);
+							return;
+						}
+					}
+				}
+
+				Post([op] {
+					Finish(op);
+				});
+			}
+
+			// completes a pending operation with err, returns false if it is no longer pending
+			bool Cancel(const Descriptor::Ptr &d, OpType t, const Operation::Ptr &op, const util::error::Error &err) {
+				{
+					std::lock_guard<std::mutex> lg(d->_mutex);
+					auto &ops = d->_ops[static_cast<size_t>(t)];
+					auto i = std::find(ops.begin(), ops.end(), op);
+					if (i == ops.end()) {
+						return false;
+					}
+					ops.erase(i);
+				}
+
+				op->Abort(err);
+				Post([op] {
+					Finish(op);
+				});
+				return true;
+			}
+
+			void Arm(TimerWheel::Timer &timer, const Deadline &deadline) {
+				_timers.Arm(timer, deadline);
+				// only a deadline before the end of the current wait needs to interrupt it
+				if (deadline.time_since_epoch().count() < _wait_until.load()) {
+					Wakeup();
+				}
+			}
+
+			TimerWheel &Timers() noexcept {
+				return _timers;
+			}
+
+			void Post(Task task) {
+				{
+					std::lock_guard<std::mutex> lg(_mutex);
+					_tasks.push(std::move(task));
+				}
+				Wakeup();
+			}
+
+			void Run() {
+				while (!Stopped()) {
+					RunOnce(-1);
+				}
+			}
+
+			size_t RunOnce(int timeout_ms) {
+				// timers armed until the wait below starts always wake it up
+				_wait_until = NO_DEADLINE.time_since_epoch().count();
+
+				std::queue<Task> tasks;
+				{
+					std::lock_guard<std::mutex> lg(_mutex);
+					std::swap(tasks, _tasks);
+				}
+
+				if (!tasks.empty()) {
+					timeout_ms = 0;
+				}
+				else {
+					int next = _timers.NextTimeout();
+					if ((next >= 0) && ((timeout_ms < 0) || (next < timeout_ms))) {
+						timeout_ms = next;
+					}
+				}
+
+				if (timeout_ms >= 0) {
+					_wait_until = (Clock::now() + std::chrono::milliseconds(timeout_ms)).time_since_epoch().count();
+				}
+
+				epoll_event events[MAX_EVENTS];
+				int n = epoll_wait(_epfd, events, MAX_EVENTS, timeout_ms);
+				_wait_until = NO_DEADLINE.time_since_epoch().count();
+
+				std::vector<Operation::Ptr> completed;
+				for (int i = 0; i < n; i++) {
+					if (events[i].data.fd == _evfd) {
+						if (!Stopped()) {
+							uint64_t counter;
+							while (::read(_evfd, &counter, sizeof(counter)) > 0) {}
+						}
+						continue;
+					}
+
+					Descriptor::Ptr d;
+					{
+						std::lock_guard<std::mutex> lg(_mutex);
+						auto it = _descriptors.find(events[i].data.fd);
+						if (it == _descriptors.end()) {
+							continue;
+						}
+						d = it->second;
+					}
+
+					Dispatch(d, events[i].events, completed);
+				}
+
+				size_t count = tasks.size() + completed.size();
+				for (; !tasks.empty(); tasks.pop()) {
+					tasks.front()();
+				}
+				for (auto &op : completed) {
+					Finish(op);
+				}
+
+				return count + _timers.Advance();
+			}
+
+			void Stop() noexcept {
+				_stopped = true;
+				Wakeup();
+			}
+
+			void Restart() noexcept {
+				_stopped = false;
+			}
+
+			bool Stopped() const noexcept {
+				return _stopped.load();
+			}
+
+		private:
+			static const int MAX_EVENTS = 128;
+
+			int _epfd;
+			int _evfd;
+			std::atomic_bool _stopped;
+
+			std::mutex _mutex;
+			std::queue<Task> _tasks;
+			std::unordered_map<int, Descriptor::Ptr> _descriptors;
+
+			TimerWheel _timers;
+			std::atomic<Clock::rep> _wait_until;
+
+		private:
+			static void Finish(const Operation::Ptr &op) {
+				if (op->_timer) {
+					op->_timer->Cancel();
+				}
+				op->Complete();
+			}
+
+			void Wakeup() noexcept {
+				uint64_t one = 1;
+				ssize_t ret = ::write(_evfd, &one, sizeof(one));
+				(void)ret;
+			}
+
+			void Dispatch(const Descriptor::Ptr &d, uint32_t events, std::vector<Operation::Ptr> &completed) {
+				const uint32_t ERROR_EVENTS = EPOLLERR | EPOLLHUP;
+
+				std::lock_guard<std::mutex> lg(d->_mutex);
+				if (events & (EPOLLIN | EPOLLRDHUP | ERROR_EVENTS)) {
+					Dispatch(d->_ops[static_cast<size_t>(OpType::READ)], completed);
+				}
+				if (events & (EPOLLOUT | ERROR_EVENTS)) {
+					Dispatch(d->_ops[static_cast<size_t>(OpType::WRITE)], completed);
+				}
+			}
+
+			void Dispatch(std::deque<Operation::Ptr> &ops, std::vector<Operation::Ptr> &completed) {
+				while (!ops.empty() && ops.front()->Perform()) {
+					completed.push_back(ops.front());
+					ops.pop_front();
+				}
+			}
+		};
+
+	}
+
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <algorithm>
+
+#include <Util/Error.h>
+#include <Util/Buffer.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace util {
+
+	namespace buffer {
+
+		// Fixed capacity dynamic buffer for ReadUntil. The storage is mapped twice back to back,
+		// so readable and writable regions are always contiguous even when they wrap: Consume only
+		// moves the head and Prepare hands out memory as is. Where the mirror cannot be mapped the
+		// data lives in one plain block that is compacted when the tail runs out of room.
+		class RingBuffer {
+		public:
+			using ValueType = std::string;
+			using const_iterator = const char *;
+
+		public:
+			explicit RingBuffer(size_t capacity) noexcept
+				: _data(nullptr),
+				_capacity(0),
+				_head(0),
+				_size(0),
+				_prepared(0),
+				_mirrored(false) {
+				Allocate(capacity);
+			}
+
+			RingBuffer(const RingBuffer &) = delete;
+			RingBuffer &operator=(const RingBuffer &) = delete;
+
+			virtual ~RingBuffer() {
+				Free();
+			}
+
+			size_t Size() const noexcept {
+				return _size;
+			}
+
+			size_t MaxSize() const noexcept {
+				return _capacity;
+			}
+
+			size_t Capacity() const noexcept {
+				return _capacity;
+			}
+
+			bool Mirrored() const noexcept {
+				return _mirrored;
+			}
+
+			MutableBuffer Prepare(size_t n, util::error::Error &err) {
+				size_t available = _capacity - _size;
+				if ((available == 0) || (n > available)) {
+					err = util::error::RuntimeError(util::error::RuntimeErrorCode::MEMORY_LIMIT_EXCEEDED);
+					return MutableBuffer();
+				}
+
+				if (!_mirrored && ((_head + _size + n) > _capacity)) {
+					std::memmove(_data, _data + _head, _size);
+					_head = 0;
+				}
+
+				_prepared = n;
+				return MutableBuffer(_data + _head + _size, n);
+			}
+
+			void Commit(size_t n) {
+				_size += (std::min)(n, _prepared);
+				_prepared = 0;
+			}
+
+			void Consume(size_t n) {
+				size_t consume_size = (std::min)(n, _size);
+				_size -= consume_size;
+				_head += consume_size;
+				if (_size == 0) {
+					_head = 0;
+				}
+				else if (_mirrored && (_head >= _capacity)) {
+					_head -= _capacity;
+				}
+			}
+
+			void Consume(std::string &s, size_t n) {
+				s.assign(begin(), (std::min)(n, _size));
+				Consume(n);
+			}
+
+			// the first n bytes in place, valid until the next Prepare or Consume
+			std::string_view View(size_t n) const noexcept {
+				return std::string_view(begin(), (std::min)(n, _size));
+			}
+
+		// iterator
+		public:
+			const_iterator begin() const noexcept {
+				return _data + _head;
+			}
+
+			const_iterator end() const noexcept {
+				return (begin() + _size);
+			}
+
+		private:
+			char *_data;
+			size_t _capacity;
+			size_t _head;
+			size_t _size;
+			size_t _prepared;
+			bool _mirrored;
+
+		private:
+			void Allocate(size_t capacity) noexcept {
+#if defined(__linux__)
+				size_t page = (size_t)sysconf(_SC_PAGESIZE);
+				size_t size = ((capacity + page - 1) / page) * page;
+				if (size == 0) {
+					size = page;
+				}
+				if (Mirror(size)) {
+					return;
+				}
+#endif
+				_data = new (std::nothrow) char[capacity];
+				_capacity = _data ? capacity : 0;
+			}
+
+#if defined(__linux__)
+			// reserves twice the size and maps the same memory file into both halves
+			bool Mirror(size_t size) noexcept {
+				int fd = (int)syscall(SYS_memfd_create, "ring", 1u /* MFD_CLOEXEC */);
+				if (fd < 0) {
+					return false;
+				}
+				if (ftruncate(fd, (off_t)size) != 0) {
+					close(fd);
+					return false;
+				}
+
+				void *base = mmap(nullptr, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+				if (base == MAP_FAILED) {
+					close(fd);
+					return false;
+				}
+
+				char *p = static_cast<char *>(base);
+				bool ok = (mmap(p, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED)
+					&& (mmap(p + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED);
+				close(fd);
+				if (!ok) {
+					munmap(base, size * 2);
+					return false;
+				}
+
+				_data = p;
+				_capacity = size;
+				_mirrored = true;
+				return true;
+			}
+#endif
+
+			void Free() noexcept {
+				if (!_data) {
+					return;
+				}
+#if defined(__linux__)
+				if (_mirrored) {
+					munmap(_data, _capacity * 2);
+					_data = nullptr;
+					return;
+				}
+#endif
+				delete[] _data;
+				_data = nullptr;
+			}
+		};
+
+	}
+
+}
\ No newline at end of file
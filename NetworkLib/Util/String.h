@@ -3,6 +3,22 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define UTIL_STRING_AVX2
+#define UTIL_STRING_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define UTIL_STRING_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace util {
 
@@ -17,7 +33,7 @@ namespace util {
 
 		class Join {
 		public:
-			explicit Join(std::string &sep = std::string(" ")) noexcept
+			explicit Join(const std::string &sep = std::string(" ")) noexcept
 				: _sep(sep) {}
 
 			void operator()(std::string &s) const noexcept {
@@ -40,64 +56,203 @@ namespace util {
 
 		const Join JoinSpace;
 
-		template<class Elem>
-		class Pattern {
-		public:
-			using value_type = typename Elem::value_type;
-			using const_iterator = typename Elem::const_iterator;
+		inline unsigned LowestBit(uint32_t mask) noexcept {
+#if defined(_MSC_VER)
+			unsigned long i;
+			_BitScanForward(&i, mask);
+			return (unsigned)i;
+#else
+			return (unsigned)__builtin_ctz(mask);
+#endif
+		}
 
-		public:
-			template<class ...Pats>
-			Pattern(Pats &&...pats)
-				: _matched(false) {
-				_pats = { pats... };
-				_offs.resize(Size());
-				for (size_t i = 0; i < Size(); i++) {
-					_offs[i] = _pats[i].begin();
+		// the first byte of [first, last) that is one of the n bytes of set, last if there is none;
+		// compares 32 or 16 bytes at a time where the target has AVX2 or SSE2
+		inline const char *FindFirstOf(const char *first, const char *last, const char *set, size_t n) noexcept {
+			static const size_t MAX_SET = 8;
+
+#if defined(UTIL_STRING_SSE2)
+			if ((n > 0) && (n <= MAX_SET)) {
+#if defined(UTIL_STRING_AVX2)
+				__m256i wide[MAX_SET];
+				for (size_t i = 0; i < n; i++) {
+					wide[i] = _mm256_set1_epi8(set[i]);
+				}
+				for (; (last - first) >= 32; first += 32) {
+					__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+					__m256i eq = _mm256_cmpeq_epi8(v, wide[0]);
+					for (size_t i = 1; i < n; i++) {
+						eq = _mm256_or_si256(eq, _mm256_cmpeq_epi8(v, wide[i]));
+					}
+					uint32_t mask = (uint32_t)_mm256_movemask_epi8(eq);
+					if (mask) {
+						return first + LowestBit(mask);
+					}
+				}
+#endif
+				__m128i narrow[MAX_SET];
+				for (size_t i = 0; i < n; i++) {
+					narrow[i] = _mm_set1_epi8(set[i]);
+				}
+				for (; (last - first) >= 16; first += 16) {
+					__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+					__m128i eq = _mm_cmpeq_epi8(v, narrow[0]);
+					for (size_t i = 1; i < n; i++) {
+						eq = _mm_or_si128(eq, _mm_cmpeq_epi8(v, narrow[i]));
+					}
+					uint32_t mask = (uint32_t)_mm_movemask_epi8(eq);
+					if (mask) {
+						return first + LowestBit(mask);
+					}
 				}
 			}
+#endif
 
-			bool Matched() const noexcept {
-				return _matched;
+			if (n == 1) {
+				const void *p = std::memchr(first, set[0], (size_t)(last - first));
+				return p ? static_cast<const char *>(p) : last;
 			}
 
-			bool Consume(value_type c) {
-				if (_matched) {
-					return _matched;
+			for (; first != last; ++first) {
+				if (std::memchr(set, *first, n)) {
+					return first;
 				}
+			}
+			return last;
+		}
+
+		// Aho-Corasick automaton over a fixed set of delimiters, built at compile time when the
+		// delimiters are literals. Failure links are folded into a full transition table, so
+		// every byte costs one lookup and partial matches that overlap (\r\r\n) are kept.
+		using MatchState = uint16_t;
+
+		template<size_t STATES>
+		class Matcher {
+		public:
+			using State = MatchState;
+
+			static const size_t npos = (size_t)-1;
+			static const size_t MAX_ENDS = 8;
+
+			static_assert(STATES <= 65535, "too many delimiter bytes");
+
+		public:
+			template<size_t ...N>
+			constexpr Matcher(const char (&...pats)[N]) noexcept
+				: _next{}, _accept{}, _ends{}, _nends(0), _max(0) {
+				State states = 1;
+				(Insert(pats, N - 1, states), ...);
+				Link();
+			}
+
+			// feeds c and tells whether a delimiter ends with it; s starts at zero
+			constexpr bool Consume(State &s, char c) const noexcept {
+				s = _next[s][(unsigned char)c];
+				return _accept[s];
+			}
 
-				const_iterator ci;
-				for (size_t i = 0; i < Size(); i++) {
-					if (Consume(c, i)) {
-						return (_matched = true);
+			// the offset just past the first delimiter that ends at or after from, npos if none does yet
+			size_t Search(const char *begin, const char *end, size_t from) const noexcept {
+				if (_nends > MAX_ENDS) {
+					State s = 0;
+					const char *cur = begin + ((from > _max) ? (from - _max) : 0);
+					for (; cur != end; ++cur) {
+						if (Consume(s, *cur) && ((size_t)(cur - begin) >= from)) {
+							return (size_t)(cur - begin) + 1;
+						}
 					}
+					return npos;
 				}
 
-				return false;
+				// only the final byte of a delimiter can complete it; replay the bytes a delimiter could span
+				const char *cur = begin + from;
+				while ((cur = FindFirstOf(cur, end, _ends, _nends)) != end) {
+					size_t n = (size_t)(cur - begin) + 1;
+					State s = 0;
+					for (const char *i = cur + 1 - (std::min)(n, _max); i != cur; ++i) {
+						s = _next[s][(unsigned char)*i];
+					}
+					if (Consume(s, *cur)) {
+						return n;
+					}
+					++cur;
+				}
+				return npos;
 			}
 
 		private:
-			bool _matched;
-
-			std::vector<Elem> _pats;
-			std::vector<const_iterator> _offs;
+			State _next[STATES][256];
+			bool _accept[STATES];
+			char _ends[MAX_ENDS];
+			size_t _nends;
+			size_t _max;
 
 		private:
-			size_t Size() const noexcept {
-				return _pats.size();
+			constexpr void Insert(const char *p, size_t len, State &states) noexcept {
+				if (len == 0) {
+					return;
+				}
+
+				State s = 0;
+				for (size_t i = 0; i < len; i++) {
+					unsigned char c = (unsigned char)p[i];
+					if (_next[s][c] == 0) {
+						_next[s][c] = states++;
+					}
+					s = _next[s][c];
+				}
+				_accept[s] = true;
+
+				_max = (std::max)(_max, len);
+				bool known = false;
+				for (size_t i = 0; (i < _nends) && (i < MAX_ENDS); i++) {
+					known = known || (_ends[i] == p[len - 1]);
+				}
+				if (!known) {
+					if (_nends < MAX_ENDS) {
+						_ends[_nends] = p[len - 1];
+					}
+					++_nends;
+				}
 			}
 
-			bool Consume(value_type c, size_t i) {
-				const_iterator end = _pats[i].end();
-				const_iterator &off = _offs[i];
-				if ((off != end) && ((*off) == c)) {
-					++off;
-					return (off == end);
+			// breadth first, so the failure target of a state is complete before the state itself
+			constexpr void Link() noexcept {
+				State fail[STATES] = {};
+				State queue[STATES] = {};
+				size_t head = 0;
+				size_t tail = 0;
+
+				for (size_t c = 0; c < 256; c++) {
+					if (_next[0][c] != 0) {
+						queue[tail++] = _next[0][c];
+					}
+				}
+
+				while (head < tail) {
+					State u = queue[head++];
+					_accept[u] = _accept[u] || _accept[fail[u]];
+					for (size_t c = 0; c < 256; c++) {
+						// the row of u still holds only trie edges, rows of shallower states are complete
+						State v = _next[u][c];
+						if (v != 0) {
+							fail[v] = _next[fail[u]][c];
+							queue[tail++] = v;
+						}
+						else {
+							_next[u][c] = _next[fail[u]][c];
+						}
+					}
 				}
-				return false;
 			}
 		};
 
+		// a matcher sized for the given delimiter literals, e.g. constexpr auto m = MakeMatcher("\r\n", "\n");
+		template<size_t ...N>
+		constexpr Matcher<(0 + ... + (N - 1)) + 1> MakeMatcher(const char (&...pats)[N]) noexcept {
+			return Matcher<(0 + ... + (N - 1)) + 1>(pats...);
+		}
+
 	}
 
 }
\ No newline at end of file
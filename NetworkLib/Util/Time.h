@@ -5,7 +5,11 @@
 #include <sstream>
 #include <iomanip>
 
+#ifdef _WIN32
 #include <WinSock2.h>
+#else
+#include <sys/time.h>
+#endif
 
 #include <Util/Locale.h>
 
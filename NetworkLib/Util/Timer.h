@@ -0,0 +1,309 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <functional>
+
+namespace util {
+
+	namespace io {
+
+		using Clock = std::chrono::steady_clock;
+		using Deadline = Clock::time_point;
+
+		const Deadline NO_DEADLINE = Deadline::max();
+
+		// a zero timeout means no deadline
+		inline Deadline After(std::chrono::milliseconds timeout) noexcept {
+			return (timeout.count() > 0) ? Clock::now() + timeout : NO_DEADLINE;
+		}
+
+		inline bool Expired(const Deadline &deadline) noexcept {
+			return (deadline != NO_DEADLINE) && (Clock::now() >= deadline);
+		}
+
+		// Hierarchical timing wheel with millisecond ticks. Timers are intrusive list nodes,
+		// so arming and cancelling are O(1); far timers cascade down a level every 64 ticks.
+		class TimerWheel {
+		public:
+			using Task = std::function<void()>;
+
+			class Timer {
+			public:
+				using Ptr = typename std::shared_ptr<Timer>;
+
+				friend class TimerWheel;
+
+			public:
+				explicit Timer(Task task) noexcept
+					: _task(std::move(task)),
+					_wheel(nullptr),
+					_prev(nullptr),
+					_next(nullptr),
+					_expires(0),
+					_tick(0) {}
+
+				Timer(const Timer &) = delete;
+				Timer &operator=(const Timer &) = delete;
+
+				virtual ~Timer() {
+					Cancel();
+				}
+
+				static Ptr New(Task task) {
+					return std::make_shared<Timer>(std::move(task));
+				}
+
+				bool Cancel() noexcept {
+					TimerWheel *wheel = _wheel.load();
+					return wheel ? wheel->Cancel(*this) : false;
+				}
+
+				bool Armed() const noexcept {
+					return (_wheel.load() != nullptr);
+				}
+
+			private:
+				Task _task;
+
+				std::atomic<TimerWheel *> _wheel;
+
+				Timer *_prev;
+				Timer *_next;
+				uint64_t _expires;
+				uint64_t _tick;
+			};
+
+		public:
+			TimerWheel() noexcept
+				: _start(Clock::now()),
+				_current(0),
+				_count(0) {
+				for (auto &level : _slots) {
+					for (auto &slot : level) {
+						slot = nullptr;
+					}
+				}
+			}
+
+			TimerWheel(const TimerWheel &) = delete;
+			TimerWheel &operator=(const TimerWheel &) = delete;
+
+			virtual ~TimerWheel() {
+				std::lock_guard<std::mutex> lg(_mutex);
+				for (auto &level : _slots) {
+					for (auto &slot : level) {
+						for (Timer *t = slot; t; t = t->_next) {
+							t->_wheel = nullptr;
+						}
+						slot = nullptr;
+					}
+				}
+			}
+
+			// re-arming an armed timer moves it
+			void Arm(Timer &t, const Deadline &deadline) {
+				TimerWheel *wheel = t._wheel.load();
+				if (wheel && (wheel != this)) {
+					wheel->Cancel(t);
+				}
+
+				std::lock_guard<std::mutex> lg(_mutex);
+				if (t._wheel == this) {
+					Unlink(t);
+				}
+
+				t._wheel = this;
+				t._expires = Tick(deadline);
+				Link(t);
+			}
+
+			size_t Size() const noexcept {
+				std::lock_guard<std::mutex> lg(_mutex);
+				return _count;
+			}
+
+			// milliseconds until the next timer may expire, -1 if none is armed
+			int NextTimeout() const {
+				std::lock_guard<std::mutex> lg(_mutex);
+				if (_count == 0) {
+					return -1;
+				}
+
+				uint64_t now = Tick(Clock::now());
+				uint64_t next = NextTick();
+				return (next > now) ? (int)(std::min<uint64_t>)(next - now, INT32_MAX) : 0;
+			}
+
+			// runs the tasks of every timer expired by now, returns their number
+			size_t Advance(const Deadline &now = Clock::now()) {
+				std::vector<Task> expired;
+				{
+					std::lock_guard<std::mutex> lg(_mutex);
+					uint64_t target = Tick(now);
+					while (_count > 0) {
+						// nothing happens on the ticks in between, skip them
+						uint64_t tick = NextTick();
+						if (tick > target) {
+							break;
+						}
+						_current = tick;
+
+						size_t index = (size_t)(_current & SLOT_MASK);
+						if (index == 0) {
+							Cascade(1);
+						}
+
+						Timer *t = _slots[0][index];
+						_slots[0][index] = nullptr;
+						while (t) {
+							Timer *next = t->_next;
+							t->_prev = t->_next = nullptr;
+							--_count;
+							if (t->_expires > _current) {
+								// clamped beyond the top level
+								Link(*t);
+							}
+							else {
+								t->_wheel = nullptr;
+								expired.push_back(t->_task);
+							}
+							t = next;
+						}
+						++_current;
+					}
+					_current = (std::max)(_current, target + 1);
+				}
+
+				for (auto &task : expired) {
+					task();
+				}
+				return expired.size();
+			}
+
+		private:
+			static constexpr size_t LEVELS = 4;
+			static constexpr size_t SLOT_BITS = 6;
+			static constexpr size_t SLOTS = 1 << SLOT_BITS;
+			static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+			static constexpr uint64_t MAX_DELTA = (1ull << (SLOT_BITS * LEVELS)) - 1;
+
+			Deadline _start;
+			uint64_t _current;
+			size_t _count;
+
+			mutable std::mutex _mutex;
+			Timer *_slots[LEVELS][SLOTS];
+
+		private:
+			uint64_t Tick(const Deadline &d) const noexcept {
+				if (d <= _start) {
+					return 0;
+				}
+				if (d == NO_DEADLINE) {
+					return UINT64_MAX;
+				}
+				return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(d - _start).count();
+			}
+
+			bool Cancel(Timer &t) noexcept {
+				std::lock_guard<std::mutex> lg(_mutex);
+				if (t._wheel != this) {
+					return false;
+				}
+
+				Unlink(t);
+				t._wheel = nullptr;
+				return true;
+			}
+
+			void Link(Timer &t) noexcept {
+				uint64_t expires = (std::max)(t._expires, _current);
+				uint64_t delta = (std::min)(expires - _current, MAX_DELTA);
+				uint64_t tick = _current + delta;
+
+				size_t level = 0;
+				while ((level < LEVELS - 1) && (delta >= (1ull << (SLOT_BITS * (level + 1))))) {
+					++level;
+				}
+
+				Timer *&head = _slots[level][(size_t)((tick >> (SLOT_BITS * level)) & SLOT_MASK)];
+				t._tick = tick;
+				t._prev = nullptr;
+				t._next = head;
+				if (head) {
+					head->_prev = &t;
+				}
+				head = &t;
+				++_count;
+			}
+
+			void Unlink(Timer &t) noexcept {
+				if (t._prev) {
+					t._prev->_next = t._next;
+				}
+				else {
+					for (size_t level = 0; level < LEVELS; level++) {
+						Timer *&head = _slots[level][(size_t)((t._tick >> (SLOT_BITS * level)) & SLOT_MASK)];
+						if (head == &t) {
+							head = t._next;
+							break;
+						}
+					}
+				}
+				if (t._next) {
+					t._next->_prev = t._prev;
+				}
+				t._prev = t._next = nullptr;
+				--_count;
+			}
+
+			void Cascade(size_t level) noexcept {
+				if (level >= LEVELS) {
+					return;
+				}
+
+				size_t index = (size_t)((_current >> (SLOT_BITS * level)) & SLOT_MASK);
+				if (index == 0) {
+					Cascade(level + 1);
+				}
+
+				Timer *t = _slots[level][index];
+				_slots[level][index] = nullptr;
+				while (t) {
+					Timer *next = t->_next;
+					--_count;
+					Link(*t);
+					t = next;
+				}
+			}
+
+			// lower bound of the next expiry: the nearest occupied slot of level 0 or the nearest
+			// tick at which an occupied slot of a higher level is cascaded
+			uint64_t NextTick() const noexcept {
+				uint64_t next = UINT64_MAX;
+				for (size_t level = 0; level < LEVELS; level++) {
+					uint64_t shift = SLOT_BITS * level;
+					uint64_t base = _current >> shift;
+					// the current slot of a higher level is cascaded on its first tick and
+					// then only holds timers of the next round
+					bool aligned = ((_current & ((1ull << shift) - 1)) == 0);
+					uint64_t first = aligned ? 0 : 1;
+					for (uint64_t i = first; i < first + SLOTS; i++) {
+						if (_slots[level][(size_t)((base + i) & SLOT_MASK)]) {
+							next = (std::min)(next, (std::max)(_current, (base + i) << shift));
+							break;
+						}
+					}
+				}
+				return next;
+			}
+		};
+
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,307 @@
+#pragma once
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+
+#include <chrono>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <unordered_set>
+#include <cstdint>
+
+#include <cerrno>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include <Util/Error.h>
+#include <Util/Buffer.h>
+#include <Util/Timer.h>
+
+#define UTIL_IO_URING
+
+namespace util {
+
+	namespace io {
+
+		class Uring {
+		public:
+			struct Completion {
+				uint64_t user_data;
+				int res;
+			};
+
+		public:
+			explicit Uring(unsigned entries = 64) noexcept
+				: _fd(-1),
+				_pending(0),
+				_sq_ptr(MAP_FAILED),
+				_cq_ptr(MAP_FAILED),
+				_sqes(static_cast<io_uring_sqe *>(MAP_FAILED)) {
+				io_uring_params p;
+				std::memset(&p, 0, sizeof(p));
+				_fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+				if (_fd < 0) {
+					return;
+				}
+
+				_sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+				_cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+				bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP);
+				if (single_mmap) {
+					_sq_size = _cq_size = (std::max)(_sq_size, _cq_size);
+				}
+
+				_sq_ptr = mmap(nullptr, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+				if (_sq_ptr == MAP_FAILED) {
+					Close();
+					return;
+				}
+
+				_cq_ptr = single_mmap ? _sq_ptr
+					: mmap(nullptr, _cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+				if (_cq_ptr == MAP_FAILED) {
+					Close();
+					return;
+				}
+
+				_sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+				_sqes = static_cast<io_uring_sqe *>(
+					mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES));
+				if (_sqes == MAP_FAILED) {
+					Close();
+					return;
+				}
+
+				char *sq = static_cast<char *>(_sq_ptr);
+				_sq_head = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+				_sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+				_sq_mask = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+				_sq_entries = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_entries);
+				_sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+
+				char *cq = static_cast<char *>(_cq_ptr);
+				_cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+				_cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+				_cq_mask = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+				_cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+
+				_timeouts.resize(_sq_entries);
+			}
+
+			Uring(const Uring &) = delete;
+			Uring &operator=(const Uring &) = delete;
+
+			virtual ~Uring() {
+				Close();
+			}
+
+			bool IsOpen() const noexcept {
+				return (_fd >= 0);
+			}
+
+			void RegisterBuffers(const std::vector<util::buffer::MutableBuffer> &bs, util::error::Error &err) {
+				std::vector<iovec> iovs(bs.size());
+				for (size_t i = 0; i < bs.size(); i++) {
+					iovs[i].iov_base = bs[i].Data();
+					iovs[i].iov_len = bs[i].Size();
+				}
+
+				int ret = (int)syscall(__NR_io_uring_register, _fd, IORING_REGISTER_BUFFERS, iovs.data(), (unsigned)iovs.size());
+				if (ret < 0) {
+					err = util::error::lib::SystemError(errno, "io_uring_register");
+				}
+			}
+
+			void UnregisterBuffers() noexcept {
+				syscall(__NR_io_uring_register, _fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+			}
+
+			bool PrepareRecv(int fd, const util::buffer::MutableBuffer &b, uint64_t user_data) {
+				return Prepare(IORING_OP_RECV, fd, b.Data(), b.Size(), 0, user_data);
+			}
+
+			bool PrepareSend(int fd, const util::buffer::ConstBuffer &b, uint64_t user_data) {
+				return Prepare(IORING_OP_SEND, fd, b.Data(), b.Size(), 0, user_data);
+			}
+
+			bool PrepareRead(int fd, const util::buffer::MutableBuffer &b, uint64_t offset, uint64_t user_data) {
+				return Prepare(IORING_OP_READ, fd, b.Data(), b.Size(), offset, user_data);
+			}
+
+			bool PrepareWrite(int fd, const util::buffer::ConstBuffer &b, uint64_t offset, uint64_t user_data) {
+				return Prepare(IORING_OP_WRITE, fd, b.Data(), b.Size(), offset, user_data);
+			}
+
+			bool PrepareReadFixed(int fd, const util::buffer::MutableBuffer &b, uint64_t offset, unsigned index, uint64_t user_data) {
+				return Prepare(IORING_OP_READ_FIXED, fd, b.Data(), b.Size(), offset, user_data, index);
+			}
+
+			bool PrepareWriteFixed(int fd, const util::buffer::ConstBuffer &b, uint64_t offset, unsigned index, uint64_t user_data) {
+				return Prepare(IORING_OP_WRITE_FIXED, fd, b.Data(), b.Size(), offset, user_data, index);
+			}
+
+			// cancels the entry prepared last when it is still running at the deadline, which then
+			// completes with -ECANCELED; the timeout itself completes too, under user_data
+			bool PrepareLinkTimeout(const Deadline &deadline, uint64_t user_data) {
+				if ((deadline == NO_DEADLINE) || (_pending == 0)) {
+					return true;
+				}
+
+				unsigned tail = *_sq_tail;
+				__kernel_timespec &ts = _timeouts[tail & _sq_mask];
+				auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+				ts.tv_sec = ns / 1000000000;
+				ts.tv_nsec = ns % 1000000000;
+				if (!Prepare(IORING_OP_LINK_TIMEOUT, -1, &ts, 1, 0, user_data)) {
+					return false;
+				}
+
+				// steady_clock is CLOCK_MONOTONIC, the clock of io_uring timeouts
+				_sqes[tail & _sq_mask].timeout_flags = IORING_TIMEOUT_ABS;
+				_sqes[(tail - 1) & _sq_mask].flags |= IOSQE_IO_LINK;
+				return true;
+			}
+
+			// submits every prepared entry in a single io_uring_enter and waits for at least wait_nr completions
+			void Submit(unsigned wait_nr, util::error::Error &err) {
+				unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+				for (;;) {
+					int ret = (int)syscall(__NR_io_uring_enter, _fd, _pending, wait_nr, flags, nullptr, 0);
+					if (ret >= 0) {
+						_pending -= (std::min)((unsigned)ret, _pending);
+						return;
+					}
+					if (errno != EINTR) {
+						err = util::error::lib::SystemError(errno, "io_uring_enter");
+						return;
+					}
+				}
+			}
+
+			bool PeekCompletion(Completion &c) noexcept {
+				for (;;) {
+					unsigned head = *_cq_head;
+					if (head == __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)) {
+						return false;
+					}
+
+					const io_uring_cqe &cqe = _cqes[head & _cq_mask];
+					c.user_data = cqe.user_data;
+					c.res = cqe.res;
+					__atomic_store_n(_cq_head, head + 1, __ATOMIC_RELEASE);
+					if (c.user_data == CANCEL_USER_DATA) {
+						continue;
+					}
+
+					auto i = _inflight.find(c.user_data);
+					if (i != _inflight.end()) {
+						_inflight.erase(i);
+					}
+					return true;
+				}
+			}
+
+			// cancels the requests still in flight and waits until every one of them has completed,
+			// so that none completes later into a buffer that is in use again; their results are dropped
+			void Cancel(util::error::Error &err) {
+				for (uint64_t user_data : _inflight) {
+					if (!Prepare(IORING_OP_ASYNC_CANCEL, -1, reinterpret_cast<const void *>(user_data), 0, 0, CANCEL_USER_DATA)) {
+						break;
+					}
+				}
+
+				Completion c;
+				while (!_inflight.empty()) {
+					Submit(1, err);
+					if (err) {
+						return;
+					}
+					while (PeekCompletion(c)) {}
+				}
+			}
+
+		private:
+			// user_data of the cancel requests, whose completions are not reported
+			static const uint64_t CANCEL_USER_DATA = ~(uint64_t)0;
+
+			int _fd;
+			unsigned _pending;
+			// user_data of the requests prepared and not completed yet
+			std::unordered_multiset<uint64_t> _inflight;
+
+			void *_sq_ptr;
+			void *_cq_ptr;
+			size_t _sq_size;
+			size_t _cq_size;
+
+			unsigned *_sq_head;
+			unsigned *_sq_tail;
+			unsigned *_sq_array;
+			unsigned _sq_mask;
+			unsigned _sq_entries;
+
+			io_uring_sqe *_sqes;
+			size_t _sqes_size;
+			// the timespec of a link timeout, by submission queue slot; read when it is submitted
+			std::vector<__kernel_timespec> _timeouts;
+
+			unsigned *_cq_head;
+			unsigned *_cq_tail;
+			unsigned _cq_mask;
+			io_uring_cqe *_cqes;
+
+		private:
+			bool Prepare(uint8_t opcode, int fd, const void *addr, size_t len, uint64_t offset, uint64_t user_data, unsigned index = 0) {
+				unsigned tail = *_sq_tail;
+				if (tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) >= _sq_entries) {
+					return false;
+				}
+
+				unsigned i = tail & _sq_mask;
+				io_uring_sqe *sqe = &_sqes[i];
+				std::memset(sqe, 0, sizeof(*sqe));
+				sqe->opcode = opcode;
+				sqe->fd = fd;
+				sqe->addr = reinterpret_cast<uint64_t>(addr);
+				sqe->len = (uint32_t)len;
+				sqe->off = offset;
+				sqe->buf_index = (uint16_t)index;
+				sqe->user_data = user_data;
+
+				_sq_array[i] = i;
+				__atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+				++_pending;
+				if (user_data != CANCEL_USER_DATA) {
+					_inflight.insert(user_data);
+				}
+				return true;
+			}
+
+			void Close() noexcept {
+				if (_sqes != MAP_FAILED) {
+					munmap(_sqes, _sqes_size);
+					_sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+				}
+				if ((_cq_ptr != MAP_FAILED) && (_cq_ptr != _sq_ptr)) {
+					munmap(_cq_ptr, _cq_size);
+				}
+				_cq_ptr = MAP_FAILED;
+				if (_sq_ptr != MAP_FAILED) {
+					munmap(_sq_ptr, _sq_size);
+					_sq_ptr = MAP_FAILED;
+				}
+				if (_fd >= 0) {
+					::close(_fd);
+					_fd = -1;
+				}
+			}
+		};
+
+	}
+
+}
+
+#endif
\ No newline at end of file